@@ -0,0 +1,159 @@
+#include "smol/jobs.h"
+#include "smol/log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// kick_heavy with captures spilled into slab blocks against the new/delete boxing it replaced.
+// usage: smol-bench [jobs per run] [runs]
+
+namespace
+{
+    using namespace smol;
+
+    enum class path_e
+    {
+        NEW_DELETE,
+        SLAB
+    };
+
+    // owns a string so it is never stored inline, SIZE is the size of the whole capture
+    template <size_t SIZE>
+    struct payload_t
+    {
+        std::string tag = "smol-bench";
+        u8_t bytes[SIZE - sizeof(std::string)] = {};
+    };
+
+    // the job only touches its capture, any real work would hide the allocation
+    template <size_t SIZE>
+    auto make_task(u32_t index)
+    {
+        payload_t<SIZE> payload;
+        payload.bytes[0] = static_cast<u8_t>(index);
+
+        return [payload]()
+        {
+            volatile u8_t sink = static_cast<u8_t>(payload.bytes[0] + payload.tag.size());
+            (void)sink;
+        };
+    }
+
+    // kick_heavy before the slab, one operator new per job and a delete on whichever worker ran it
+    template <typename Lambda>
+    void kick_boxed(Lambda&& task, jobs::counter_t* counter)
+    {
+        using decayed_lambda_t = std::decay_t<Lambda>;
+        decayed_lambda_t* payload = new decayed_lambda_t(std::forward<Lambda>(task));
+
+        jobs::kick(
+            [payload]()
+            {
+                (*payload)();
+                delete payload;
+            },
+            counter);
+    }
+
+    // producers kick their share from the workers. with one producer every block is freed on another thread than
+    // the one that allocated it, with one per thread allocations and frees spread over the whole pool
+    template <size_t SIZE>
+    f64 run(path_e path, u32_t job_count, u32_t producers)
+    {
+        jobs::counter_t counter;
+        u32_t share = (job_count + producers - 1) / producers;
+
+        auto start = std::chrono::steady_clock::now();
+
+        jobs::dispatch(
+            job_count, share,
+            [path, &counter](u32_t first, u32_t last)
+            {
+                for (u32_t i = first; i < last; i++)
+                {
+                    if (path == path_e::SLAB) { jobs::kick_heavy(make_task<SIZE>(i), &counter); }
+                    else { kick_boxed(make_task<SIZE>(i), &counter); }
+                }
+            },
+            &counter);
+        jobs::wait(&counter);
+
+        std::chrono::duration<f64, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / job_count;
+    }
+
+    f64 median(std::vector<f64>& samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    // both paths take turns so clock and thermal drift hit them alike, the first round is a warmup
+    template <size_t SIZE>
+    void bench(u32_t workers, u32_t producers, u32_t job_count, u32_t runs)
+    {
+        std::vector<f64> boxed;
+        std::vector<f64> slab;
+
+        for (u32_t i = 0; i <= runs; i++)
+        {
+            f64 boxed_ns = run<SIZE>(path_e::NEW_DELETE, job_count, producers);
+            f64 slab_ns = run<SIZE>(path_e::SLAB, job_count, producers);
+            if (i == 0) { continue; }
+
+            boxed.push_back(boxed_ns);
+            slab.push_back(slab_ns);
+        }
+
+        f64 boxed_median = median(boxed);
+        f64 slab_median = median(slab);
+        SMOL_LOG_INFO("BENCH", "{:>3} workers {:>3} producers {:>5}B  new/delete {:>7.1f}ns  slab {:>7.1f}ns  {:+.1f}%",
+                      workers, producers, SIZE, boxed_median, slab_median,
+                      (boxed_median - slab_median) / boxed_median * 100.0);
+    }
+
+    void bench_sizes(u32_t workers, u32_t producers, u32_t job_count, u32_t runs)
+    {
+        bench<64>(workers, producers, job_count, runs);
+        bench<128>(workers, producers, job_count, runs);
+        bench<256>(workers, producers, job_count, runs);
+        bench<1024>(workers, producers, job_count, runs);
+    }
+} // namespace
+
+int main(i32 argc, char** argv)
+{
+    smol::log::init();
+
+    u32_t job_count = argc > 1 ? static_cast<u32_t>(std::max(1, std::atoi(argv[1]))) : 200000;
+    u32_t runs = argc > 2 ? static_cast<u32_t>(std::max(1, std::atoi(argv[2]))) : 7;
+
+    u32_t max_workers = std::max(1u, std::thread::hardware_concurrency() - 1);
+    std::vector<u32_t> worker_counts;
+    for (u32_t workers = 1; workers < max_workers; workers *= 2) { worker_counts.push_back(workers); }
+    worker_counts.push_back(max_workers);
+
+    SMOL_LOG_INFO("BENCH", "kick_heavy, {} jobs per run, median of {} runs, per job cost", job_count, runs);
+
+    for (u32_t workers : worker_counts)
+    {
+        jobs::config_t config;
+        config.high_workers = workers;
+        jobs::configure(config);
+        jobs::init();
+
+        bench_sizes(workers, 1, job_count, runs);
+        if (workers > 1) { bench_sizes(workers, workers + 1, job_count, runs); }
+
+        jobs::shutdown();
+    }
+
+    smol::log::shutdown();
+    return 0;
+}
\ No newline at end of file
@@ -16,6 +16,7 @@
 #include "smol/hash.h"
 #include "smol/log.h"
 #include "smol/os.h"
+#include "smol/physics/physics_config.h"
 #include "smol/project.h"
 #include "smol/rendering/renderer.h"
 #include "smol/rendering/renderer_types.h"
@@ -310,6 +311,9 @@ bool open_project(const std::filesystem::path& project_file, smol::editor_contex
         return false;
     }
 
+    // worlds created from here on, like the one play mode runs, are sized by the project
+    smol::physics::configure(project.physics_config);
+
     source_lib_path = project.lib_path;
     trigger_path = project.trigger_path;
     source_lib_name = project.lib_path.string();
@@ -4,7 +4,9 @@
 #include "smol/ecs_fwd.h"
 #include "smol/engine.h"
 #include "smol/game.h"
+#include "smol/jobs.h"
 #include "smol/log.h"
+#include "smol/physics/physics_config.h"
 #include "smol/project.h"
 #include "smol/serialization.h"
 #include "smol/vfs.h"
@@ -12,7 +14,9 @@
 
 #include <SDL3/SDL_filesystem.h>
 #include <SDL3/SDL_main.h>
+#include <cstdlib>
 #include <filesystem>
+#include <string_view>
 
 #ifdef SMOL_STATIC_LINK
 extern "C" void smol_game_init(smol::world_t* world);
@@ -34,19 +38,43 @@ smol::os::lib_handle_t game_lib = nullptr;
 
 int main(int argc, char* argv[])
 {
+    // --headless [--tick-rate=<hz>] [--unthrottled] [--ticks=<n>] runs without window, input and renderer
+    bool headless = false;
+    smol::engine::headless_config_t headless_config;
+    const char* project_path = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+
+        if (arg == "--headless") { headless = true; }
+        else if (arg == "--unthrottled") { headless_config.is_unthrottled = true; }
+        else if (arg.starts_with("--tick-rate=")) { headless_config.tick_rate = std::atof(argv[i] + 12); }
+        else if (arg.starts_with("--ticks=")) { headless_config.max_ticks = std::strtoull(argv[i] + 8, nullptr, 10); }
+        else if (!project_path) { project_path = argv[i]; }
+    }
+
     smol::project_t project;
-    bool have_project = argc >= 2 && smol::project_t::load(argv[1], project);
+    bool have_project = project_path && smol::project_t::load(project_path, project);
 
 #ifndef SMOL_STATIC_LINK
-    if (argc >= 2 && !have_project)
+    if (project_path && !have_project)
     {
-        SMOL_LOG_FATAL("ENGINE", "Failed to load project file: {}", argv[1]);
+        SMOL_LOG_FATAL("ENGINE", "Failed to load project file: {}", project_path);
         return -1;
     }
 #endif
 
+    if (have_project)
+    {
+        smol::jobs::configure(project.jobs_config);
+        smol::physics::configure(project.physics_config);
+    }
+
     const char* window_name = have_project ? project.project_name.c_str() : "smol";
-    if (!smol::engine::init(window_name, 1280, 720)) { return -1; }
+    bool is_initialized = headless ? smol::engine::init_headless(window_name, headless_config)
+                                   : smol::engine::init(window_name, 1280, 720);
+    if (!is_initialized) { return -1; }
 
 #if SMOL_PLATFORM_ANDROID
     smol::asset_meta::init("guid_map.json");
@@ -112,7 +140,8 @@ int main(int argc, char* argv[])
     else
     {
         SMOL_LOG_WARN("ENGINE",
-                      "No project file given; running an empty world. Usage: smol-runtime <path-to-.smolproject>");
+                      "No project file given; running an empty world. Usage: smol-runtime <path-to-.smolproject> "
+                      "[--headless [--tick-rate=<hz>] [--unthrottled] [--ticks=<n>]]");
     }
 #endif
 
@@ -176,4 +205,4 @@ int main(int argc, char* argv[])
 #endif
 
     return 0;
-}
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "smol/asset_handle.h"
 #include "smol/asset_loader.h"
 #include "smol/asset_types.h"
+#include "smol/jobs.h"
 
 #include <atomic>
 #include <deque>
@@ -36,6 +37,9 @@ namespace smol
             std::atomic<asset_state_e> state = asset_state_e::UNLOADED;
             std::atomic<i32_t> ref_count = 0;
             std::string path;
+
+            // held while an async load is in flight
+            jobs::counter_t load_counter;
         };
 
         bool base_validate(u32_t index, uuid_t uuid) override
@@ -8,6 +8,7 @@
 #include "smol/defines.h"
 #include "smol/hash.h"
 #include "smol/jobs.h"
+#include "smol/jobs/task.h"
 #include "smol/log.h"
 
 #include <atomic>
@@ -25,6 +26,12 @@
 
 namespace smol
 {
+    // loaders that need other assets first can provide a coroutine instead of a blocking load()
+    template <typename T, typename... Args>
+    concept has_asset_load_task = requires(const std::string& path, Args&&... args) {
+        { asset_loader_t<T>::load_task(path, std::forward<Args>(args)...) } -> std::same_as<jobs::task<std::optional<T>>>;
+    };
+
     class asset_registry_t
     {
       public:
@@ -40,11 +47,22 @@ namespace smol
 
         template <typename T, typename... Args>
         asset_handle_t load_async(const std::string& path, Args&&... args)
-        { return internal_load<T>(path, false, std::forward<Args>(args)...); }
+        { return internal_load<T>(path, false, nullptr, std::forward<Args>(args)...); }
 
         template <typename T, typename... Args>
         asset_handle_t load_sync(const std::string& path, Args&&... args)
-        { return internal_load<T>(path, true, std::forward<Args>(args)...); }
+        { return internal_load<T>(path, true, nullptr, std::forward<Args>(args)...); }
+
+        // async load that can be co_awaited from a job, resumes once the asset is ready or failed
+        template <typename T, typename... Args>
+        jobs::task<asset_handle_t> load_task(std::string path, Args... args)
+        {
+            jobs::counter_t* load_counter = nullptr;
+            asset_handle_t handle = internal_load<T>(path, false, &load_counter, std::move(args)...);
+
+            co_await *load_counter;
+            co_return handle;
+        }
 
         template <typename T>
         T* get(asset_handle_t handle)
@@ -154,8 +172,31 @@ namespace smol
             return *cached_pool;
         }
 
+        template <typename T>
+        static void finish_load(typename asset_pool_t<T>::slot_t* slot, const std::string& path, std::optional<T> res)
+        {
+            if (res)
+            {
+                slot->data = std::move(*res);
+                slot->state = asset_state_e::READY;
+            }
+            else
+            {
+                slot->state = asset_state_e::FAILED;
+                SMOL_LOG_ERROR("ASSET", "Failed to load: {}", path);
+            }
+        }
+
         template <typename T, typename... Args>
-        asset_handle_t internal_load(const std::string& path, bool is_sync, Args&&... args)
+        static jobs::task<void> run_load_task(typename asset_pool_t<T>::slot_t* slot, std::string path, Args... args)
+        {
+            std::optional<T> res = co_await asset_loader_t<T>::load_task(path, args...);
+            finish_load<T>(slot, path, std::move(res));
+        }
+
+        template <typename T, typename... Args>
+        asset_handle_t internal_load(const std::string& path, bool is_sync, jobs::counter_t** out_load_counter,
+                                     Args&&... args)
         {
             uuid_t uuid = smol::asset_meta::resolve_uuid(path);
 
@@ -170,6 +211,7 @@ namespace smol
                 typename asset_pool_t<T>::slot_t* slot =
                     static_cast<typename asset_pool_t<T>::slot_t*>(it->second.slot_ptr);
                 slot->ref_count.fetch_add(1);
+                if (out_load_counter) { *out_load_counter = &slot->load_counter; }
                 return asset_handle_t{uuid, slot->id};
             }
 
@@ -198,28 +240,36 @@ namespace smol
 
             lookup[uuid] = {slot, type_id, path};
 
+            // keeps anyone awaiting this slot from seeing it as finished before the load is queued
+            jobs::detail::add_ref(&slot->load_counter, 1);
+
             map_lock.unlock();
 
-            auto load_func = [slot, path, ... args = std::forward<Args>(args)]() mutable
+            if (out_load_counter) { *out_load_counter = &slot->load_counter; }
+
+            if constexpr (has_asset_load_task<T, Args...>)
             {
-                std::optional<T> res = asset_loader_t<T>::load(path, args...);
+                jobs::task<void> load = run_load_task<T>(slot, path, std::forward<Args>(args)...);
+                if (is_sync) { jobs::spawn_inline(std::move(load), &slot->load_counter); }
+                else { jobs::spawn(std::move(load), &slot->load_counter, jobs::priority_e::LOW); }
+                jobs::detail::release_ref(&slot->load_counter);
+
+                // the loader's dependencies are queued on the io pool, the caller works through that queue too
+                // instead of sleeping until the io workers get to them
+                if (is_sync) { jobs::wait(&slot->load_counter, true); }
+            }
+            else
+            {
+                auto load_func = [slot, path, ... args = std::forward<Args>(args)]() mutable
+                { finish_load<T>(slot, path, asset_loader_t<T>::load(path, args...)); };
 
-                if (res)
-                {
-                    slot->data = std::move(*res);
-                    slot->state = asset_state_e::READY;
-                }
+                if (is_sync) { load_func(); }
                 else
                 {
-                    slot->state = asset_state_e::FAILED;
-                    SMOL_LOG_ERROR("ASSET", "Failed to load: {}", path);
+                    smol::jobs::kick_heavy(std::move(load_func), &slot->load_counter, jobs::priority_e::LOW);
                 }
-            };
 
-            if (is_sync) { load_func(); }
-            else
-            {
-                smol::jobs::kick_heavy(std::move(load_func), nullptr, jobs::priority_e::LOW);
+                jobs::detail::release_ref(&slot->load_counter);
             }
 
             return asset_handle_t{uuid, slot->id};
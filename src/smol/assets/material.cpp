@@ -81,13 +81,14 @@ namespace smol
         }
     }
 
-    std::optional<material_t> asset_loader_t<material_t>::load(const std::string& path, asset_handle_t target_shader)
+    jobs::task<std::optional<material_t>> asset_loader_t<material_t>::load_task(std::string path,
+                                                                                asset_handle_t target_shader)
     {
         if (target_shader.is_valid())
         {
             material_t mat(target_shader);
-            if (!mat.shader_handle.is_valid()) { return std::nullopt; }
-            return mat;
+            if (!mat.shader_handle.is_valid()) { co_return std::nullopt; }
+            co_return mat;
         }
 
         std::string cooked_path = get_cooked_path(path, ".smolmat");
@@ -95,27 +96,27 @@ namespace smol
         if (bytes.empty())
         {
             SMOL_LOG_WARN("MATERIAL", "Material file not found: {}", cooked_path);
-            return std::nullopt;
+            co_return std::nullopt;
         }
 
         if (bytes.size() < sizeof(material_header_t))
         {
             SMOL_LOG_ERROR("MATERIAL", "Truncated material file: {}", cooked_path);
-            return std::nullopt;
+            co_return std::nullopt;
         }
 
         material_header_t* header = reinterpret_cast<material_header_t*>(bytes.data());
         if (header->magic != SMOL_MATERIAL_MAGIC)
         {
             SMOL_LOG_ERROR("MATERIAL", "Invalid material magic in: {}", cooked_path);
-            return std::nullopt;
+            co_return std::nullopt;
         }
 
         if (header->version != SMOL_MATERIAL_VERSION)
         {
             SMOL_LOG_ERROR("MATERIAL", "Unsupported material version {} (engine expects {}), recook: {}",
                            header->version, SMOL_MATERIAL_VERSION, cooked_path);
-            return std::nullopt;
+            co_return std::nullopt;
         }
 
         u32_t offset = sizeof(material_header_t);
@@ -123,27 +124,22 @@ namespace smol
         if (offset + header->shader_path_length > bytes.size())
         {
             SMOL_LOG_ERROR("MATERIAL", "Truncated shader path in: {}", cooked_path);
-            return std::nullopt;
+            co_return std::nullopt;
         }
         std::string shader_path(reinterpret_cast<char*>(bytes.data() + offset), header->shader_path_length);
         offset += header->shader_path_length;
 
-        asset_handle_t shader_handle = smol::engine::get_asset_registry().load_sync<shader_t>(shader_path);
-        if (!shader_handle.is_valid())
-        {
-            SMOL_LOG_ERROR("MATERIAL", "Failed to load shader '{}' for material", shader_path);
-            return std::nullopt;
-        }
-
-        material_t mat(shader_handle);
-        if (!mat.shader_handle.is_valid()) { return std::nullopt; }
+        std::vector<u32_t> texture_names;
+        std::vector<std::string> texture_paths;
+        texture_names.reserve(header->texture_count);
+        texture_paths.reserve(header->texture_count);
 
         for (u32_t i = 0; i < header->texture_count; i++)
         {
             if (offset + sizeof(cooked_texture_bind_t) > bytes.size())
             {
                 SMOL_LOG_ERROR("MATERIAL", "Truncated texture bind in: {}", cooked_path);
-                return std::nullopt;
+                co_return std::nullopt;
             }
             cooked_texture_bind_t* tex_bind = reinterpret_cast<cooked_texture_bind_t*>(bytes.data() + offset);
             offset += sizeof(cooked_texture_bind_t);
@@ -151,16 +147,46 @@ namespace smol
             if (offset + tex_bind->path_length > bytes.size())
             {
                 SMOL_LOG_ERROR("MATERIAL", "Truncated texture path in: {}", cooked_path);
-                return std::nullopt;
+                co_return std::nullopt;
             }
-            std::string tex_path(reinterpret_cast<char*>(bytes.data() + offset), tex_bind->path_length);
+            texture_names.push_back(tex_bind->name_hash);
+            texture_paths.emplace_back(reinterpret_cast<char*>(bytes.data() + offset), tex_bind->path_length);
             offset += tex_bind->path_length;
+        }
+
+        // shader and textures load side by side, the loader is suspended instead of blocking the io worker
+        asset_registry_t& registry = smol::engine::get_asset_registry();
+
+        std::vector<jobs::task<asset_handle_t>> dependency_loads;
+        dependency_loads.reserve(texture_paths.size() + 1);
+        dependency_loads.push_back(registry.load_task<shader_t>(shader_path));
+        for (const std::string& tex_path : texture_paths)
+        {
+            dependency_loads.push_back(registry.load_task<texture_t>(tex_path));
+        }
 
-            asset_handle_t tex_handle = smol::engine::get_asset_registry().load_sync<texture_t>(tex_path);
-            if (tex_handle.is_valid()) { mat.set_texture(tex_bind->name_hash, tex_handle); }
+        std::vector<asset_handle_t> handles = co_await jobs::when_all(std::move(dependency_loads));
+
+        asset_handle_t shader_handle = handles[0];
+        if (!shader_handle.is_valid() || !registry.get<shader_t>(shader_handle))
+        {
+            SMOL_LOG_ERROR("MATERIAL", "Failed to load shader '{}' for material", shader_path);
+            co_return std::nullopt;
+        }
+
+        material_t mat(shader_handle);
+        if (!mat.shader_handle.is_valid()) { co_return std::nullopt; }
+
+        for (u32_t i = 0; i < texture_paths.size(); i++)
+        {
+            asset_handle_t tex_handle = handles[i + 1];
+            if (tex_handle.is_valid() && registry.get<texture_t>(tex_handle))
+            {
+                mat.set_texture(texture_names[i], tex_handle);
+            }
             else
             {
-                SMOL_LOG_WARN("MATERIAL", "Failed to load texture '{}' for material", tex_path);
+                SMOL_LOG_WARN("MATERIAL", "Failed to load texture '{}' for material", texture_paths[i]);
             }
         }
 
@@ -169,7 +195,7 @@ namespace smol
             if (offset + sizeof(cooked_sampler_bind_t) > bytes.size())
             {
                 SMOL_LOG_ERROR("MATERIAL", "Truncated sampler bind in: {}", cooked_path);
-                return std::nullopt;
+                co_return std::nullopt;
             }
             cooked_sampler_bind_t* smp_bind = reinterpret_cast<cooked_sampler_bind_t*>(bytes.data() + offset);
             offset += sizeof(cooked_sampler_bind_t);
@@ -182,7 +208,7 @@ namespace smol
             if (offset + sizeof(cooked_property_t) > bytes.size())
             {
                 SMOL_LOG_ERROR("MATERIAL", "Truncated property in: {}", cooked_path);
-                return std::nullopt;
+                co_return std::nullopt;
             }
             cooked_property_t* prop = reinterpret_cast<cooked_property_t*>(bytes.data() + offset);
             offset += sizeof(cooked_property_t);
@@ -190,13 +216,13 @@ namespace smol
             if (offset + prop->data_size > bytes.size())
             {
                 SMOL_LOG_ERROR("MATERIAL", "Truncated property data in: {}", cooked_path);
-                return std::nullopt;
+                co_return std::nullopt;
             }
             mat.set_property_raw(prop->name_hash, bytes.data() + offset, prop->data_size);
             offset += prop->data_size;
         }
 
-        return mat;
+        co_return mat;
     }
 
     void asset_loader_t<material_t>::unload(material_t& mat)
@@ -4,6 +4,7 @@
 #include "smol/assets/texture.h"
 #include "smol/defines.h"
 #include "smol/engine.h"
+#include "smol/jobs/task.h"
 #include "smol/log.h"
 #include "smol/rendering/renderer_constants.h"
 #include "smol/rendering/samplers.h"
@@ -80,7 +81,7 @@ namespace smol
     template <>
     struct SMOL_ENGINE_API asset_loader_t<material_t>
     {
-        static std::optional<material_t> load(const std::string& path, asset_handle_t target_shader = {});
+        static jobs::task<std::optional<material_t>> load_task(std::string path, asset_handle_t target_shader = {});
         static void unload(material_t& mat);
     };
 } // namespace smol
\ No newline at end of file
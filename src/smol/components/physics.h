@@ -2,6 +2,7 @@
 
 #include "smol/defines.h"
 #include "smol/math.h"
+#include "smol/physics/physics_config.h"
 
 #include <Jolt/Jolt.h>
 #include <Jolt/Physics/Body/BodyID.h>
@@ -20,8 +21,15 @@ namespace smol
         JPH::BodyID body_id;
 
         body_type_e type = body_type_e::DYNAMIC;
+        u32_t layer = physics::AUTO_LAYER; // index into physics_config_t::layers, see physics::find_layer
         bool is_sensor = false;
         bool is_initiaklized = false;
+
+        // poses of the last two physics steps, rendering blends between them
+        vec3_t prev_position;
+        quat_t prev_rotation;
+        vec3_t cur_position;
+        quat_t cur_rotation;
     };
 
     struct SMOL_ENGINE_API box_collider_t
@@ -7,21 +7,26 @@
 
 namespace smol
 {
+    // facade over the transform system's pose storage. local_* are what scenes, the editor and gameplay read and
+    // write, mark_dirty copies them into the system's arrays. the world matrix only lives there, see
+    // transform_system::get_world_matrix
     struct SMOL_ENGINE_API transform_t
     {
         vec3_t local_position;
         quat_t local_rotation;
         vec3_t local_scale = {1.0f, 1.0f, 1.0f};
 
-        mat4_t local_mat;
-        mat4_t world_mat;
-
         ecs::entity_t parent = ecs::NULL_ENTITY;
         ecs::entity_t first_child = ecs::NULL_ENTITY;
         ecs::entity_t next_sibling = ecs::NULL_ENTITY;
         ecs::entity_t prev_sibling = ecs::NULL_ENTITY;
 
-        i32_t parent_dense_index = -1;
+        // slot in the transform system's depth levels
+        u32_t depth = 0;
+        u32_t level_index = ~0u;
+        // local_* changed, set through transform_system::mark_dirty so the transform gets picked up
         bool is_dirty = false;
+        // part of the current update's work set
+        bool is_world_dirty = false;
     };
 } // namespace smol
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "smol/input.h"
 #include "smol/jobs.h"
 #include "smol/log.h"
+#include "smol/physics/physics_sync.h"
 #include "smol/profiling.h"
 #include "smol/reflection.h"
 #include "smol/rendering/renderer.h"
@@ -19,6 +20,7 @@
 #include "smol/systems/camera.h"
 #include "smol/systems/events.h"
 #include "smol/systems/shadows.h"
+#include "smol/systems/spatial.h"
 #include "smol/systems/transform.h"
 #include "smol/time.h"
 #include "smol/vfs.h"
@@ -50,15 +52,18 @@ namespace smol::engine
     {
         std::string game_name;
         std::unique_ptr<world_t> active_scene;
+        std::vector<std::unique_ptr<world_t>> worlds;
         asset_registry_t engine_assets;
         bool is_running = true;
         bool is_suspended = false;
+        bool headless = false;
+        headless_config_t headless_config;
 
         event_callback_t user_event_cb;
         ui_callback_t user_ui_cb;
     } // namespace
 
-    bool init(const std::string& name, i32 init_window_width, i32 init_window_height)
+    static void init_core(const std::string& name, bool with_gpu_assets)
     {
         smol::vfs::init();
 
@@ -71,21 +76,40 @@ namespace smol::engine
         smol::reflection::register_types();
         smol::jobs::init();
 
-        smol::asset_serde::reg(
-            smol::get_type_id<smol::mesh_t>(),
-            [](smol::asset_registry_t& r, const std::string& p) { return r.load_sync<smol::mesh_t>(p); }, "Mesh");
-        smol::asset_serde::reg(
-            smol::get_type_id<smol::material_t>(), [](smol::asset_registry_t& r, const std::string& p)
-            { return r.load_sync<smol::material_t>(p); }, "Material");
-        smol::asset_serde::reg(
-            smol::get_type_id<smol::texture_t>(),
-            [](smol::asset_registry_t& r, const std::string& p) { return r.load_sync<smol::texture_t>(p); }, "Texture");
-        smol::asset_serde::reg(
-            smol::get_type_id<smol::shader_t>(),
-            [](smol::asset_registry_t& r, const std::string& p) { return r.load_sync<smol::shader_t>(p); }, "Shader");
+        if (with_gpu_assets)
+        {
+            smol::asset_serde::reg(
+                smol::get_type_id<smol::mesh_t>(),
+                [](smol::asset_registry_t& r, const std::string& p) { return r.load_sync<smol::mesh_t>(p); }, "Mesh");
+            smol::asset_serde::reg(
+                smol::get_type_id<smol::material_t>(), [](smol::asset_registry_t& r, const std::string& p)
+                { return r.load_sync<smol::material_t>(p); }, "Material");
+            smol::asset_serde::reg(
+                smol::get_type_id<smol::texture_t>(), [](smol::asset_registry_t& r, const std::string& p)
+                { return r.load_sync<smol::texture_t>(p); }, "Texture");
+            smol::asset_serde::reg(
+                smol::get_type_id<smol::shader_t>(), [](smol::asset_registry_t& r, const std::string& p)
+                { return r.load_sync<smol::shader_t>(p); }, "Shader");
+        }
+        else
+        {
+            // these loaders upload to the gpu, without a renderer scenes keep empty handles instead
+            smol::asset_serde::load_fn_t skip = [](smol::asset_registry_t&, const std::string&)
+            { return smol::asset_handle_t{}; };
+            smol::asset_serde::reg(smol::get_type_id<smol::mesh_t>(), skip, "Mesh");
+            smol::asset_serde::reg(smol::get_type_id<smol::material_t>(), skip, "Material");
+            smol::asset_serde::reg(smol::get_type_id<smol::texture_t>(), skip, "Texture");
+            smol::asset_serde::reg(smol::get_type_id<smol::shader_t>(), skip, "Shader");
+        }
+
         smol::asset_serde::reg(
             smol::get_type_id<smol::scene_t>(),
             [](smol::asset_registry_t& r, const std::string& p) { return r.load_sync<smol::scene_t>(p); }, "Scene");
+    }
+
+    bool init(const std::string& name, i32 init_window_width, i32 init_window_height)
+    {
+        init_core(name, true);
 
         // SDL_SetHintWithPriority(SDL_HINT_SHUTDOWN_DBUS_ON_QUIT, "1", SDL_HintPriority::SDL_HINT_OVERRIDE);
         SDL_Init(SDL_INIT_VIDEO);
@@ -127,8 +151,81 @@ namespace smol::engine
         return true;
     }
 
+    bool init_headless(const std::string& name, const headless_config_t& config)
+    {
+        init_core(name, false);
+
+        headless = true;
+        headless_config = config;
+        if (headless_config.tick_rate <= 0.0)
+        {
+            SMOL_LOG_WARN("ENGINE", "Invalid headless tick rate {}, using 60", headless_config.tick_rate);
+            headless_config.tick_rate = 60.0;
+        }
+
+        SMOL_LOG_INFO("ENGINE", "Running headless at {} ticks per second{}", headless_config.tick_rate,
+                      headless_config.is_unthrottled ? ", unthrottled" : "");
+        return true;
+    }
+
+    bool is_headless() { return headless; }
+
+    // simulation time instead of wall time, a tick is exactly one fixed step no matter how long it took
+    static void run_headless()
+    {
+        const f64 fixed_timestep = 1.0 / headless_config.tick_rate;
+        const u64_t tick_ns = static_cast<u64_t>(1000000000.0 / headless_config.tick_rate);
+        smol::time::fixed_dt = fixed_timestep;
+        smol::physics::interpolation_alpha = 1.0f;
+
+        u64_t ticks = 0;
+        u64_t next_tick_ns = SDL_GetTicksNS();
+
+        while (is_running)
+        {
+            smol::jobs::begin_frame();
+
+            smol::time::dt = fixed_timestep;
+            smol::time::time += fixed_timestep;
+
+            fixed_update_worlds();
+
+            if (active_scene)
+            {
+                active_scene->update();
+                smol::transform_system::update(active_scene->registry);
+                smol::spatial_system::update(active_scene->registry);
+                smol::event_system::clear_frame_events(active_scene->registry);
+            }
+
+            smol::jobs::plot_stats();
+            FrameMark;
+
+            ticks++;
+            if (headless_config.max_ticks != 0 && ticks >= headless_config.max_ticks) { break; }
+
+            if (!headless_config.is_unthrottled)
+            {
+                next_tick_ns += tick_ns;
+                u64_t now_ns = SDL_GetTicksNS();
+
+                // fell behind by more than a tick, don't try to catch up in a burst
+                if (now_ns > next_tick_ns + tick_ns) { next_tick_ns = now_ns; }
+                else if (now_ns < next_tick_ns) { SDL_DelayPrecise(next_tick_ns - now_ns); }
+            }
+        }
+
+        SMOL_LOG_INFO("ENGINE", "Headless run stopped after {} ticks", ticks);
+    }
+
     void run()
     {
+        if (headless)
+        {
+            run_headless();
+            return;
+        }
+
         constexpr f64 fixed_timestep = 1.0 / 60.0; // this should be in a settings file later on
         smol::time::fixed_dt = fixed_timestep;
         f64 accumulator = 0.0;
@@ -137,6 +234,8 @@ namespace smol::engine
 
         while (is_running)
         {
+            smol::jobs::begin_frame();
+
             if (!is_suspended)
             {
                 smol::time::update();
@@ -185,16 +284,19 @@ namespace smol::engine
 
             while (accumulator >= fixed_timestep)
             {
-                active_scene->fixed_update();
+                fixed_update_worlds();
                 accumulator -= fixed_timestep;
             }
 
             if (user_ui_cb) { user_ui_cb(); }
 
-            // smol::physics::interpolation_alpha = static_cast<f32>(accumulator / fixed_timestep);
+            smol::physics::interpolation_alpha = static_cast<f32>(accumulator / fixed_timestep);
+            smol::physics::interpolate_poses(active_scene->registry);
+
             active_scene->update();
 
             smol::transform_system::update(active_scene->registry);
+            smol::spatial_system::update(active_scene->registry);
             smol::camera_system::update(active_scene->registry);
             smol::shadow_system::update(active_scene->registry);
 
@@ -202,6 +304,7 @@ namespace smol::engine
 
             smol::event_system::clear_frame_events(active_scene->registry);
 
+            smol::jobs::plot_stats();
             FrameMark;
         }
     }
@@ -210,7 +313,10 @@ namespace smol::engine
     {
         SMOL_LOG_INFO("ENGINE", "Stopping engine.");
 
-        vkDeviceWaitIdle(renderer::ctx.device);
+        if (!headless) { vkDeviceWaitIdle(renderer::ctx.device); }
+
+        for (std::unique_ptr<world_t>& world : worlds) { world->shutdown(); }
+        worlds.clear();
 
         if (active_scene)
         {
@@ -218,12 +324,12 @@ namespace smol::engine
             active_scene.reset();
         }
 
-        smol::renderer::reset_assets();
+        if (!headless) { smol::renderer::reset_assets(); }
         engine_assets.shutdown();
         smol::asset_meta::shutdown();
-        smol::renderer::shutdown();
+        if (!headless) { smol::renderer::shutdown(); }
         smol::jobs::shutdown();
-        smol::window::shutdown();
+        if (!headless) { smol::window::shutdown(); }
         smol::log::shutdown();
 
         smol::vfs::shutdown();
@@ -261,6 +367,60 @@ namespace smol::engine
 
     world_t& get_active_world() { return *active_scene; }
 
+    world_t& add_world(std::unique_ptr<smol::world_t> world)
+    {
+        world->reflection_ctx = &smol::reflection::get_engine_context();
+        world->init();
+
+        worlds.push_back(std::move(world));
+        return *worlds.back();
+    }
+
+    void remove_world(world_t& world)
+    {
+        for (auto it = worlds.begin(); it != worlds.end(); ++it)
+        {
+            if (it->get() != &world) { continue; }
+
+            world.shutdown();
+            worlds.erase(it);
+            return;
+        }
+
+        SMOL_LOG_ERROR("ENGINE", "remove_world() called with a world the engine doesn't own");
+    }
+
+    u32_t get_world_count() { return static_cast<u32_t>(worlds.size()); }
+
+    world_t& get_world(u32_t index) { return *worlds[index]; }
+
+    void fixed_update_worlds()
+    {
+        ZoneScoped;
+
+        // worlds share nothing mutable, each one is stepped start to finish by a single job. nothing renders them,
+        // so their transforms are propagated right here instead of once per frame like the active scene's
+        jobs::counter_t counter;
+        for (std::unique_ptr<world_t>& world : worlds)
+        {
+            world_t* w = world.get();
+            jobs::kick(
+                [w]()
+                {
+                    w->fixed_update();
+                    smol::transform_system::update(w->registry);
+                    smol::spatial_system::update(w->registry);
+                    // nothing runs update() on these worlds, their frame ends with the step
+                    smol::event_system::clear_frame_events(w->registry);
+                },
+                &counter);
+        }
+
+        if (active_scene) { active_scene->fixed_update(); }
+
+        jobs::wait(&counter);
+    }
+
     asset_registry_t& get_asset_registry() { return engine_assets; }
 
     void set_event_callback(event_callback_t cb) { user_event_cb = cb; }
@@ -14,7 +14,20 @@ namespace smol::engine
     using event_callback_t = std::function<bool(const SDL_Event&)>;
     using ui_callback_t = std::function<void()>;
 
+    struct headless_config_t
+    {
+        // fixed steps per second, also sets the fixed timestep
+        f64 tick_rate = 60.0;
+        // step back to back without sleeping, for batch simulation and benchmarks
+        bool is_unthrottled = false;
+        // stop after this many ticks, 0 runs until exit()
+        u64_t max_ticks = 0;
+    };
+
     SMOL_ENGINE_API bool init(const std::string& game_name, i32 init_window_width, i32 init_window_height);
+    // no window, input or renderer. run() then only steps the worlds, one fixed step and one update per tick
+    SMOL_ENGINE_API bool init_headless(const std::string& game_name, const headless_config_t& config = {});
+    SMOL_ENGINE_API bool is_headless();
     SMOL_ENGINE_API void run();
     SMOL_ENGINE_API bool shutdown();
 
@@ -25,6 +38,18 @@ namespace smol::engine
     SMOL_ENGINE_API void create_scene();
     SMOL_ENGINE_API void set_scene(std::unique_ptr<smol::world_t> scene);
     SMOL_ENGINE_API world_t& get_active_world();
+
+    // extra worlds owned by the engine next to the active scene, e.g. many small simulations on a server.
+    // add_world() inits the world, remove_world() shuts it down. they are stepped on job workers, so even their
+    // exclusive systems must not rely on running on the main thread
+    SMOL_ENGINE_API world_t& add_world(std::unique_ptr<smol::world_t> world);
+    SMOL_ENGINE_API void remove_world(world_t& world);
+    SMOL_ENGINE_API u32_t get_world_count();
+    SMOL_ENGINE_API world_t& get_world(u32_t index);
+
+    // one fixed step for the active scene and every added world. the added worlds each run as their own job
+    // while the active scene stays on the calling thread, their events are cleared at the end of it
+    SMOL_ENGINE_API void fixed_update_worlds();
     SMOL_ENGINE_API asset_registry_t& get_asset_registry();
 
     SMOL_ENGINE_API void set_event_callback(event_callback_t cb);
@@ -1,20 +1,189 @@
 #pragma once
 
+#include "smol/defines.h"
 #include "smol/ecs.h"
+#include "smol/log.h"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace smol::events
 {
-    struct SMOL_ENGINE_API frame_event_tag
+    namespace detail
     {
+        struct SMOL_ENGINE_API event_channel_base_t
+        {
+            virtual ~event_channel_base_t() = default;
+            virtual void clear() = 0;
+        };
+
+        // append only storage for one event type. pages double in size and never move, producers only
+        // touch the slot counter and, once per page, the page pointer
+        template <typename T>
+        class event_channel_t final : public event_channel_base_t
+        {
+          public:
+            static constexpr u32_t FIRST_PAGE_SIZE = 64;
+            static constexpr u32_t MAX_PAGES = 24;
+            static constexpr u32_t CAPACITY = FIRST_PAGE_SIZE * ((1u << MAX_PAGES) - 1);
+
+            event_channel_t() = default;
+            event_channel_t(const event_channel_t&) = delete;
+            event_channel_t& operator=(const event_channel_t&) = delete;
+
+            ~event_channel_t() override
+            {
+                clear();
+                for (std::atomic<T*>& page : pages)
+                {
+                    if (T* storage = page.load(std::memory_order_relaxed))
+                    { ::operator delete(storage, std::align_val_t(alignof(T))); }
+                }
+            }
+
+            // safe from any number of threads at once. a full channel drops the event, that only happens to
+            // channels nobody clears
+            template <typename... Args>
+            void push(Args&&... args)
+            {
+                u32_t slot = count.fetch_add(1, std::memory_order_relaxed);
+                if (slot >= CAPACITY)
+                {
+                    if (slot == CAPACITY) { SMOL_LOG_ERROR("EVENTS", "Event channel is full, events are dropped"); }
+                    return;
+                }
+
+                u32_t page = page_of(slot);
+                T* dst = get_page(page) + (slot - page_begin(page));
+
+                if constexpr (std::is_aggregate_v<T>) { new (dst) T{std::forward<Args>(args)...}; }
+                else
+                {
+                    new (dst) T(std::forward<Args>(args)...);
+                }
+            }
+
+            u32_t size() const { return std::min(count.load(std::memory_order_acquire), CAPACITY); }
+
+            // only sees complete events once every producer of the frame is done, the channel is not meant to
+            // be read while someone is still emitting into it
+            template <typename Fn>
+            void for_each(Fn&& fn) const
+            {
+                u32_t n = size();
+                for (u32_t page = 0, slot = 0; slot < n; page++)
+                {
+                    const T* storage = pages[page].load(std::memory_order_acquire);
+                    u32_t end = std::min(n, page_begin(page + 1));
+                    for (; slot < end; slot++) { fn(storage[slot - page_begin(page)]); }
+                }
+            }
+
+            // pages stay around, the next frame appends into the same memory
+            void clear() override
+            {
+                u32_t n = std::min(count.exchange(0, std::memory_order_acq_rel), CAPACITY);
+                if constexpr (!std::is_trivially_destructible_v<T>)
+                {
+                    for (u32_t slot = 0; slot < n; slot++)
+                    {
+                        u32_t page = page_of(slot);
+                        pages[page].load(std::memory_order_relaxed)[slot - page_begin(page)].~T();
+                    }
+                }
+            }
+
+          private:
+            std::atomic<u32_t> count = 0;
+            std::atomic<T*> pages[MAX_PAGES] = {};
+
+            // page k holds FIRST_PAGE_SIZE << k events starting at FIRST_PAGE_SIZE * (2^k - 1)
+            static u32_t page_of(u32_t slot)
+            { return static_cast<u32_t>(std::bit_width(slot / FIRST_PAGE_SIZE + 1)) - 1; }
+
+            static u32_t page_begin(u32_t page) { return FIRST_PAGE_SIZE * ((1u << page) - 1); }
+
+            T* get_page(u32_t page)
+            {
+                T* storage = pages[page].load(std::memory_order_acquire);
+                if (storage) { return storage; }
+
+                // racing producers may both allocate, the loser hands its page back
+                size_t bytes = sizeof(T) * (FIRST_PAGE_SIZE << page);
+                T* fresh = static_cast<T*>(::operator new(bytes, std::align_val_t(alignof(T))));
+                if (pages[page].compare_exchange_strong(storage, fresh, std::memory_order_acq_rel,
+                                                        std::memory_order_acquire))
+                {
+                    return fresh;
+                }
+
+                ::operator delete(fresh, std::align_val_t(alignof(T)));
+                return storage;
+            }
+        };
+    } // namespace detail
+
+    // every event channel of one registry, lives in its ctx
+    struct SMOL_ENGINE_API event_queues_t
+    {
+        std::shared_mutex mutex;
+        std::vector<std::pair<entt::id_type, std::unique_ptr<detail::event_channel_base_t>>> channels;
+
+        template <typename T>
+        detail::event_channel_t<T>& get()
+        {
+            entt::id_type id = entt::type_hash<T>::value();
+
+            {
+                std::shared_lock lock(mutex);
+                for (auto& [channel_id, channel] : channels)
+                {
+                    if (channel_id == id) { return static_cast<detail::event_channel_t<T>&>(*channel); }
+                }
+            }
+
+            std::unique_lock lock(mutex);
+            for (auto& [channel_id, channel] : channels)
+            {
+                if (channel_id == id) { return static_cast<detail::event_channel_t<T>&>(*channel); }
+            }
+
+            channels.emplace_back(id, std::make_unique<detail::event_channel_t<T>>());
+            return static_cast<detail::event_channel_t<T>&>(*channels.back().second);
+        }
+
+        void clear()
+        {
+            for (auto& [channel_id, channel] : channels) { channel->clear(); }
+        }
     };
 
-    template <typename T, typename... Args>
-    SMOL_ENGINE_API void emit(ecs::registry_t& reg, Args&&... args)
+    // world_t::init creates the queues. the fallback only covers registries that never went through it and writes
+    // the ctx unsynchronised, so the first call on such a registry has to come from one thread
+    inline event_queues_t& get_queues(ecs::registry_t& reg)
     {
-        ecs::entity_t entity = reg.create();
-        reg.emplace<T>(entity, std::forward<Args>(args)...);
-        reg.emplace<frame_event_tag>(entity);
+        if (event_queues_t* queues = reg.ctx().find<event_queues_t>()) { return *queues; }
+        return reg.ctx().emplace<event_queues_t>();
     }
+
+    // events live until the end of the frame, emitting is safe from any thread once the registry has its queues
+    template <typename T, typename... Args>
+    void emit(ecs::registry_t& reg, Args&&... args)
+    { get_queues(reg).get<T>().push(std::forward<Args>(args)...); }
+
+    template <typename T, typename Fn>
+    void for_each(ecs::registry_t& reg, Fn&& fn)
+    { get_queues(reg).get<T>().for_each(std::forward<Fn>(fn)); }
+
+    template <typename T>
+    u32_t count(ecs::registry_t& reg)
+    { return get_queues(reg).get<T>().size(); }
 } // namespace smol::events
\ No newline at end of file
@@ -1,177 +1,965 @@
 #include "jobs.h"
 
 #include "smol/defines.h"
+#include "smol/log.h"
+#include "smol/profiling.h"
 
 #include <algorithm>
 #include <array>
 #include <atomic>
-#include <condition_variable>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <utility>
 #include <vector>
 
+#if SMOL_PLATFORM_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#endif
+
 namespace smol::jobs
 {
-    constexpr u32_t MAX_JOBS = 4096;
-    constexpr u32_t MASK = MAX_JOBS - 1;
+    constexpr size_t CACHE_LINE_SIZE = 64;
+    constexpr i64_t INITIAL_DEQUE_CAPACITY = 256;
+
+    // idle workers spin this many rounds before parking, grows when spinning pays off and shrinks when it doesn't
+    constexpr u32_t MIN_IDLE_SPINS = 16;
+    constexpr u32_t MAX_IDLE_SPINS = 1024;
+    constexpr u32_t WAIT_SPINS = 256;
+
+    constexpr size_t SCRATCH_CAPACITY = 1024 * 1024;
 
     struct job_t
     {
-        job_function<64> task;
+        job_function<> task;
         counter_t* counter = nullptr;
+#ifdef SMOL_ENABLE_JOB_STATS
+        u64_t push_ns = 0;
+#endif
+    };
+
+#ifdef SMOL_ENABLE_JOB_STATS
+    // one per deque slot, the last one is shared by threads that don't own a deque in the pool
+    struct alignas(CACHE_LINE_SIZE) worker_counters_t
+    {
+        std::atomic<u64_t> jobs_executed{0};
+        std::atomic<u64_t> steals{0};
+        std::atomic<u64_t> idle_ns{0};
+        std::atomic<u64_t> parks{0};
+        std::atomic<u64_t> unparks{0};
+        std::atomic<u32_t> max_queue_depth{0};
+        std::atomic<u32_t> frame_max_queue_depth{0};
+        std::atomic<u64_t> queue_wait_ns{0};
+        std::array<std::atomic<u64_t>, QUEUE_WAIT_BUCKETS> queue_wait_histogram{};
     };
+#endif
 
-    struct job_queue_t
+    namespace detail
     {
-        std::array<job_t, MAX_JOBS> buffer;
-        std::atomic<u32_t> head{0};
-        std::atomic<u32_t> tail{0};
-        std::mutex wake_mutex;
-        std::condition_variable wake_cv;
+        // shared by every dependency of one kick_after() call, the last one to finish pushes the job
+        struct continuation_join_t
+        {
+            job_t job;
+            priority_e prio;
+            std::atomic<u32_t> pending;
+        };
 
-        bool push(job_function<64> task, counter_t* counter)
+        // one per dependency, linked into that counter's continuation list
+        struct continuation_t
         {
-            u32_t cur_tail = tail.fetch_add(1, std::memory_order_acq_rel);
-            u32_t index = cur_tail & MASK;
+            continuation_join_t* join;
+            continuation_t* next;
+        };
+    } // namespace detail
 
-            if (tail - head > MAX_JOBS) { return false; }
+    // chase-lev deque, owner pushes/pops at the bottom, thieves take from the top
+    struct job_deque_t
+    {
+        struct ring_t
+        {
+            i64_t capacity;
+            std::unique_ptr<job_t[]> slots;
 
-            buffer[index].task = task;
-            buffer[index].counter = counter;
+            explicit ring_t(i64_t cap) : capacity(cap), slots(new job_t[cap]) {}
 
-            return true;
+            job_t& at(i64_t i) { return slots[i & (capacity - 1)]; }
+        };
+
+        alignas(CACHE_LINE_SIZE) std::atomic<i64_t> top{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<i64_t> bottom{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<ring_t*> ring{nullptr};
+
+        // thieves might still read from an old ring after a grow, so they stay alive until shutdown
+        std::vector<std::unique_ptr<ring_t>> rings;
+
+        job_deque_t()
+        {
+            rings.push_back(std::make_unique<ring_t>(INITIAL_DEQUE_CAPACITY));
+            ring.store(rings.back().get(), std::memory_order_relaxed);
+        }
+
+        ring_t* grow(ring_t* old_ring, i64_t t, i64_t b)
+        {
+            rings.push_back(std::make_unique<ring_t>(old_ring->capacity * 2));
+            ring_t* new_ring = rings.back().get();
+
+            for (i64_t i = t; i < b; i++) { new_ring->at(i) = old_ring->at(i); }
+
+            ring.store(new_ring, std::memory_order_release);
+            return new_ring;
+        }
+
+        // owner only
+        void push(const job_t& job)
+        {
+            i64_t b = bottom.load(std::memory_order_relaxed);
+            i64_t t = top.load(std::memory_order_acquire);
+            ring_t* r = ring.load(std::memory_order_relaxed);
+
+            if (b - t >= r->capacity) { r = grow(r, t, b); }
+
+            r->at(b) = job;
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
         }
 
+        // owner only
         bool pop(job_t& out_job)
         {
-            u32_t cur_head = head.load(std::memory_order_acquire);
-            while (true)
-            {
-                u32_t cur_tail = tail.load(std::memory_order_relaxed);
-                if (cur_head == cur_tail) { return false; }
+            i64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            ring_t* r = ring.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            i64_t t = top.load(std::memory_order_relaxed);
 
-                if (head.compare_exchange_weak(cur_head, cur_head + 1, std::memory_order_release,
-                                               std::memory_order_relaxed))
-                {
-                    u32_t index = cur_head & MASK;
-                    out_job = std::move(buffer[index]);
-                    return true;
-                }
+            if (t > b)
+            {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
             }
+
+            out_job = r->at(b);
+            if (t != b) { return true; }
+
+            // last job, race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        bool steal(job_t& out_job)
+        {
+            i64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            i64_t b = bottom.load(std::memory_order_acquire);
+
+            if (t >= b) { return false; }
+
+            // the slot can only be overwritten after someone else took it, in which case the cas fails and the
+            // copy is thrown away
+            ring_t* r = ring.load(std::memory_order_acquire);
+            out_job = r->at(t);
+
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        bool empty() const
+        {
+            return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+        }
+
+        i64_t size() const
+        {
+            return std::max<i64_t>(bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed), 0);
         }
     };
 
+    struct worker_pool_t
+    {
+        // one deque per worker thread, the high priority pool has an extra one for the main thread
+        std::vector<std::unique_ptr<job_deque_t>> deques;
+        std::vector<std::thread> threads;
+
+        // jobs pushed from threads that don't own a deque in this pool
+        std::mutex injector_mutex;
+        std::deque<job_t> injector;
+        std::atomic<u32_t> injector_size{0};
+
+        // parked workers wait on the epoch, pushers only touch it when someone is actually asleep
+        alignas(CACHE_LINE_SIZE) std::atomic<u32_t> wake_epoch{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<u32_t> sleeping_workers{0};
+
+#ifdef SMOL_ENABLE_JOB_STATS
+        std::vector<std::unique_ptr<worker_counters_t>> counters;
+        std::atomic<u32_t> max_injector_depth{0};
+#endif
+    };
+
     namespace
     {
-        job_queue_t high_priority_queue;
-        job_queue_t low_priority_queue;
+        worker_pool_t high_priority_pool;
+        worker_pool_t low_priority_pool;
 
-        std::vector<std::thread> high_priority_workers;
-        std::thread low_priority_worker; // one for the assets and general io
         std::atomic<bool> is_running{false};
 
-        void worker_loop(job_queue_t& queue)
+        config_t pending_config;
+
+        // bumped by begin_frame(), workers compare against it between jobs to know their scratch can go
+        std::atomic<u64_t> scratch_frame{0};
+
+        thread_local worker_pool_t* tls_pool = nullptr;
+        thread_local job_deque_t* tls_deque = nullptr;
+        thread_local u32_t tls_index = 0;
+        thread_local u32_t tls_rng = 0;
+        thread_local u32_t tls_idle_spins = MIN_IDLE_SPINS;
+        thread_local bool tls_is_worker = false;
+        thread_local linear_allocator_t tls_scratch;
+        thread_local u64_t tls_scratch_frame = 0;
+
+        worker_pool_t& get_pool(priority_e prio)
+        { return prio == priority_e::HIGH ? high_priority_pool : low_priority_pool; }
+
+        inline void cpu_relax()
         {
-            while (is_running.load(std::memory_order_relaxed))
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+            asm volatile("yield");
+#endif
+        }
+
+#ifdef SMOL_ENABLE_JOB_STATS
+        u64_t stats_now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        worker_counters_t& get_counters(worker_pool_t& pool)
+        { return *pool.counters[tls_pool == &pool ? tls_index : pool.counters.size() - 1]; }
+
+        void update_max(std::atomic<u32_t>& value, u32_t candidate)
+        {
+            u32_t current = value.load(std::memory_order_relaxed);
+            while (candidate > current &&
+                   !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
             {
-                job_t job;
-                if (queue.pop(job))
+            }
+        }
+
+        void record_push(worker_pool_t& pool, job_t& job, i64_t depth, bool injected)
+        {
+            job.push_ns = stats_now();
+
+            if (injected) { update_max(pool.max_injector_depth, static_cast<u32_t>(depth)); }
+            else
+            {
+                worker_counters_t& counters = get_counters(pool);
+                update_max(counters.max_queue_depth, static_cast<u32_t>(depth));
+                update_max(counters.frame_max_queue_depth, static_cast<u32_t>(depth));
+            }
+        }
+
+        void record_run(worker_pool_t& pool, const job_t& job)
+        {
+            worker_counters_t& counters = get_counters(pool);
+            u64_t wait_ns = stats_now() - job.push_ns;
+            u32_t bucket = std::min<u32_t>(std::bit_width(wait_ns / 1000), QUEUE_WAIT_BUCKETS - 1);
+
+            counters.jobs_executed.fetch_add(1, std::memory_order_relaxed);
+            counters.queue_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+            counters.queue_wait_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void record_steal(worker_pool_t& pool) { get_counters(pool).steals.fetch_add(1, std::memory_order_relaxed); }
+        void record_park(worker_pool_t& pool) { get_counters(pool).parks.fetch_add(1, std::memory_order_relaxed); }
+        void record_unpark(worker_pool_t& pool) { get_counters(pool).unparks.fetch_add(1, std::memory_order_relaxed); }
+
+        void record_idle(worker_pool_t& pool, u64_t since)
+        { get_counters(pool).idle_ns.fetch_add(stats_now() - since, std::memory_order_relaxed); }
+#else
+        u64_t stats_now() { return 0; }
+        void record_push(worker_pool_t&, job_t&, i64_t, bool) {}
+        void record_run(worker_pool_t&, const job_t&) {}
+        void record_steal(worker_pool_t&) {}
+        void record_park(worker_pool_t&) {}
+        void record_unpark(worker_pool_t&) {}
+        void record_idle(worker_pool_t&, u64_t) {}
+#endif
+
+        u32_t next_random()
+        {
+            // xorshift32
+            u32_t x = tls_rng ? tls_rng : 0x9e3779b9u;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            tls_rng = x;
+            return x;
+        }
+
+        void bind_thread(worker_pool_t& pool, u32_t index)
+        {
+            tls_pool = &pool;
+            tls_deque = pool.deques[index].get();
+            tls_index = index;
+            tls_rng = 0x9e3779b9u * (index + 1);
+        }
+
+        void unbind_thread()
+        {
+            tls_pool = nullptr;
+            tls_deque = nullptr;
+            tls_index = 0;
+        }
+
+        bool pop_injector(worker_pool_t& pool, job_t& out_job)
+        {
+            if (pool.injector_size.load(std::memory_order_acquire) == 0) { return false; }
+
+            std::scoped_lock lock(pool.injector_mutex);
+            if (pool.injector.empty()) { return false; }
+
+            out_job = pool.injector.front();
+            pool.injector.pop_front();
+            pool.injector_size.fetch_sub(1, std::memory_order_release);
+
+            return true;
+        }
+
+        bool steal_job(worker_pool_t& pool, job_t& out_job)
+        {
+            u32_t num_deques = static_cast<u32_t>(pool.deques.size());
+            if (num_deques == 0) { return false; }
+
+            u32_t start = next_random() % num_deques;
+            for (u32_t i = 0; i < num_deques; i++)
+            {
+                job_deque_t* victim = pool.deques[(start + i) % num_deques].get();
+                if (victim == tls_deque || victim->empty()) { continue; }
+
+                if (victim->steal(out_job))
                 {
-                    if (job.task) { job.task(); }
+                    record_steal(pool);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool find_job(worker_pool_t& pool, job_t& out_job)
+        {
+            if (tls_pool == &pool && tls_deque->pop(out_job)) { return true; }
+            if (pop_injector(pool, out_job)) { return true; }
+
+            return steal_job(pool, out_job);
+        }
+
+        void resolve_dependency(detail::continuation_join_t* join)
+        {
+            if (join->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) { return; }
+
+            detail::push_job(std::move(join->job.task), join->job.counter, join->prio);
+            detail::wake_threads(join->prio, false);
+            delete join;
+        }
+
+        void release_counter(counter_t* counter)
+        {
+            if (counter->fetch_sub(1, std::memory_order_acq_rel) != 1) { return; }
+
+            // before closing the list, a waiter may free the counter as soon as is_done() sees it closed.
+            // the standard library tracks waiters per address so this is not a syscall when nobody is parked
+            counter->notify_all();
+
+            detail::continuation_t* node = counter->continuations.exchange(detail::closed_continuations(),
+                                                                           std::memory_order_acq_rel);
+            while (node && node != detail::closed_continuations())
+            {
+                detail::continuation_t* next = node->next;
+                resolve_dependency(node->join);
+                delete node;
+                node = next;
+            }
+        }
+
+        void run_job(worker_pool_t& pool, job_t& job)
+        {
+            record_run(pool, job);
+
+            if (job.task) { job.task(); }
+            if (job.counter) { release_counter(job.counter); }
+        }
 
-                    if (job.counter) { job.counter->fetch_sub(1, std::memory_order_release); }
+        bool spin_for_job(worker_pool_t& pool, job_t& out_job)
+        {
+            for (u32_t i = 0; i < tls_idle_spins; i++)
+            {
+                cpu_relax();
+                if (find_job(pool, out_job))
+                {
+                    tls_idle_spins = std::min(tls_idle_spins * 2, MAX_IDLE_SPINS);
+                    return true;
                 }
-                else
+            }
+
+            tls_idle_spins = std::max(tls_idle_spins / 2, MIN_IDLE_SPINS);
+            return false;
+        }
+
+        bool park_worker(worker_pool_t& pool, job_t& out_job)
+        {
+            u32_t epoch = pool.wake_epoch.load(std::memory_order_acquire);
+
+            // pairs with the fence in wake_threads(), either the pusher sees us sleeping or we see its job
+            pool.sleeping_workers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            bool found = find_job(pool, out_job);
+            if (!found && is_running.load(std::memory_order_relaxed))
+            {
+                record_park(pool);
+                pool.wake_epoch.wait(epoch, std::memory_order_acquire);
+            }
+
+            pool.sleeping_workers.fetch_sub(1, std::memory_order_relaxed);
+            return found;
+        }
+
+        // "0-3,8" style cpu list, returns false on anything malformed
+        bool parse_cpu_list(const std::string& list, std::vector<u32_t>& out_cpus)
+        {
+            size_t pos = 0;
+            while (pos < list.size())
+            {
+                size_t end = list.find(',', pos);
+                if (end == std::string::npos) { end = list.size(); }
+
+                std::string range = list.substr(pos, end - pos);
+                pos = end + 1;
+                if (range.empty()) { continue; }
+
+                char* rest = nullptr;
+                unsigned long first = std::strtoul(range.c_str(), &rest, 10);
+                unsigned long last = first;
+                if (rest == range.c_str()) { return false; }
+                if (*rest == '-')
                 {
-                    std::unique_lock lock(queue.wake_mutex);
-                    queue.wake_cv.wait(lock);
+                    const char* last_begin = rest + 1;
+                    last = std::strtoul(last_begin, &rest, 10);
+                    if (rest == last_begin) { return false; }
                 }
+                if (*rest != '\0' || last < first) { return false; }
+
+                for (unsigned long cpu = first; cpu <= last; cpu++) { out_cpus.push_back(static_cast<u32_t>(cpu)); }
+            }
+
+            return !out_cpus.empty();
+        }
+
+        void set_thread_affinity(const std::string& cpu_list)
+        {
+            if (cpu_list.empty()) { return; }
+
+            std::vector<u32_t> cpus;
+            if (!parse_cpu_list(cpu_list, cpus))
+            {
+                SMOL_LOG_WARN("JOBS", "Ignoring malformed cpu list '{}'", cpu_list);
+                return;
+            }
+
+#if SMOL_PLATFORM_LINUX
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (u32_t cpu : cpus)
+            {
+                if (cpu < CPU_SETSIZE) { CPU_SET(cpu, &set); }
             }
+
+#if SMOL_PLATFORM_ANDROID
+            int result = sched_setaffinity(0, sizeof(set), &set);
+#else
+            int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+            if (result != 0) { SMOL_LOG_WARN("JOBS", "Could not pin worker to cpus '{}'", cpu_list); }
+#else
+            SMOL_LOG_WARN("JOBS", "Worker affinity is not supported on this platform, ignoring '{}'", cpu_list);
+#endif
+        }
+
+        void set_thread_name(const std::string& name)
+        {
+#ifdef SMOL_ENABLE_PROFILING
+            tracy::SetThreadName(name.c_str());
+#elif SMOL_PLATFORM_LINUX
+            pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#else
+            (void)name;
+#endif
+        }
+
+        void worker_loop(worker_pool_t& pool, u32_t index, std::string name, std::string cpu_list)
+        {
+            set_thread_name(name);
+            set_thread_affinity(cpu_list);
+
+            bind_thread(pool, index);
+            tls_is_worker = true;
+
+            while (is_running.load(std::memory_order_relaxed))
+            {
+                // no job is on the stack here, so nothing can still point into the scratch arena
+                u64_t frame = scratch_frame.load(std::memory_order_relaxed);
+                if (tls_scratch_frame != frame)
+                {
+                    tls_scratch.reset();
+                    tls_scratch_frame = frame;
+                }
+
+                job_t job;
+                if (find_job(pool, job))
+                {
+                    run_job(pool, job);
+                    continue;
+                }
+
+                u64_t idle_start = stats_now();
+                bool found = spin_for_job(pool, job) || park_worker(pool, job);
+                record_idle(pool, idle_start);
+
+                if (found) { run_job(pool, job); }
+            }
+
+            tls_is_worker = false;
+            unbind_thread();
+        }
+
+        void start_pool(worker_pool_t& pool, u32_t num_threads, u32_t num_deques, const std::string& name,
+                        const std::vector<std::string>& affinity)
+        {
+            for (u32_t i = 0; i < num_deques; i++) { pool.deques.push_back(std::make_unique<job_deque_t>()); }
+#ifdef SMOL_ENABLE_JOB_STATS
+            for (u32_t i = 0; i <= num_deques; i++) { pool.counters.push_back(std::make_unique<worker_counters_t>()); }
+#endif
+            for (u32_t i = 0; i < num_threads; i++)
+            {
+                std::string cpu_list = affinity.empty() ? std::string() : affinity[i % affinity.size()];
+                pool.threads.emplace_back(worker_loop, std::ref(pool), i, name + "-" + std::to_string(i), cpu_list);
+            }
+        }
+
+        void stop_pool(worker_pool_t& pool)
+        {
+            pool.wake_epoch.fetch_add(1, std::memory_order_release);
+            pool.wake_epoch.notify_all();
+
+            for (std::thread& worker : pool.threads)
+            {
+                if (worker.joinable()) { worker.join(); }
+            }
+            pool.threads.clear();
+            pool.deques.clear();
+#ifdef SMOL_ENABLE_JOB_STATS
+            pool.counters.clear();
+#endif
+
+            std::scoped_lock lock(pool.injector_mutex);
+            pool.injector.clear();
+            pool.injector_size.store(0, std::memory_order_relaxed);
         }
     } // namespace
 
     namespace detail
     {
-        void push_job(job_function<64> task, counter_t* counter, priority_e prio)
+        void push_job(job_function<> task, counter_t* counter, priority_e prio)
         {
-            if (prio == priority_e::HIGH) { high_priority_queue.push(std::move(task), counter); }
-            else
+            worker_pool_t& pool = get_pool(prio);
+            job_t job{std::move(task), counter};
+
+            if (tls_pool == &pool)
             {
-                low_priority_queue.push(std::move(task), counter);
+                record_push(pool, job, tls_deque->size() + 1, false);
+                tls_deque->push(job);
+                return;
             }
+
+            std::scoped_lock lock(pool.injector_mutex);
+            record_push(pool, job, static_cast<i64_t>(pool.injector.size()) + 1, true);
+            pool.injector.push_back(job);
+            pool.injector_size.fetch_add(1, std::memory_order_release);
         }
 
-        void wake_threads(priority_e prio, bool wake_all)
+        void push_jobs(job_function<>* tasks, u32_t count, counter_t* counter, priority_e prio)
         {
-            if (prio == priority_e::HIGH)
+            worker_pool_t& pool = get_pool(prio);
+
+            if (tls_pool == &pool)
+            {
+                for (u32_t i = 0; i < count; i++)
+                {
+                    job_t job{std::move(tasks[i]), counter};
+                    record_push(pool, job, tls_deque->size() + 1, false);
+                    tls_deque->push(job);
+                }
+                return;
+            }
+
+            std::scoped_lock lock(pool.injector_mutex);
+            for (u32_t i = 0; i < count; i++)
             {
-                if (wake_all) high_priority_queue.wake_cv.notify_all();
-                else high_priority_queue.wake_cv.notify_one();
+                job_t job{std::move(tasks[i]), counter};
+                record_push(pool, job, static_cast<i64_t>(pool.injector.size()) + 1, true);
+                pool.injector.push_back(job);
             }
+            pool.injector_size.fetch_add(count, std::memory_order_release);
+        }
+
+        void wake_threads(priority_e prio, bool wake_all)
+        {
+            worker_pool_t& pool = get_pool(prio);
+
+            // everyone awake is spinning or busy and will find the job on their own, no need for a syscall
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (pool.sleeping_workers.load(std::memory_order_relaxed) == 0) { return; }
+
+            pool.wake_epoch.fetch_add(1, std::memory_order_release);
+            record_unpark(pool);
+
+            if (wake_all) { pool.wake_epoch.notify_all(); }
             else
             {
-                if (wake_all) low_priority_queue.wake_cv.notify_all();
-                else low_priority_queue.wake_cv.notify_one();
+                pool.wake_epoch.notify_one();
+            }
+        }
+
+        void release_ref(counter_t* counter) { release_counter(counter); }
+
+        priority_e current_priority() { return tls_pool == &low_priority_pool ? priority_e::LOW : priority_e::HIGH; }
+
+        u32_t worker_slot(priority_e prio)
+        {
+            worker_pool_t& pool = get_pool(prio);
+            return tls_pool == &pool ? tls_index : static_cast<u32_t>(pool.deques.size());
+        }
+
+        u32_t worker_slot_count(priority_e prio) { return static_cast<u32_t>(get_pool(prio).deques.size()) + 1; }
+
+        void add_ref(counter_t* counter, i32_t count)
+        {
+            if (counter->fetch_add(count, std::memory_order_relaxed) != 0) { return; }
+
+            // counter gets reused, reopen it for new continuations
+            continuation_t* closed = closed_continuations();
+            counter->continuations.compare_exchange_strong(closed, nullptr, std::memory_order_relaxed);
+        }
+
+        void push_continuation(counter_t* const* dependencies, u32_t dependency_count, job_function<> task,
+                               counter_t* counter, priority_e prio)
+        {
+            // the extra pending count keeps the join alive until every dependency is linked
+            continuation_join_t* join = new continuation_join_t{{std::move(task), counter}, prio, dependency_count + 1};
+
+            for (u32_t i = 0; i < dependency_count; i++)
+            {
+                counter_t* dependency = dependencies[i];
+
+                if (!dependency || dependency->load(std::memory_order_acquire) <= 0)
+                {
+                    join->pending.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                continuation_t* node = new continuation_t{join, nullptr};
+                continuation_t* head = dependency->continuations.load(std::memory_order_acquire);
+
+                bool linked = false;
+                while (head != closed_continuations())
+                {
+                    node->next = head;
+                    if (dependency->continuations.compare_exchange_weak(head, node, std::memory_order_acq_rel,
+                                                                        std::memory_order_acquire))
+                    {
+                        linked = true;
+                        break;
+                    }
+                }
+
+                if (!linked)
+                {
+                    delete node;
+                    join->pending.fetch_sub(1, std::memory_order_relaxed);
+                }
             }
+
+            resolve_dependency(join);
         }
     } // namespace detail
 
+    namespace
+    {
+        void read_env_count(const char* name, u32_t& out_count)
+        {
+            const char* value = std::getenv(name);
+            if (!value || !*value) { return; }
+
+            char* end = nullptr;
+            unsigned long count = std::strtoul(value, &end, 10);
+            if (*end != '\0')
+            {
+                SMOL_LOG_WARN("JOBS", "Ignoring {}='{}', expected a number", name, value);
+                return;
+            }
+
+            out_count = static_cast<u32_t>(count);
+        }
+
+        // per worker lists are separated by ';', "0-7;8-15" pins worker 0 and worker 1 to one half each
+        void read_env_affinity(const char* name, std::vector<std::string>& out_affinity)
+        {
+            const char* value = std::getenv(name);
+            if (!value || !*value) { return; }
+
+            out_affinity.clear();
+
+            std::string lists = value;
+            size_t pos = 0;
+            while (pos <= lists.size())
+            {
+                size_t end = lists.find(';', pos);
+                if (end == std::string::npos) { end = lists.size(); }
+
+                if (end > pos) { out_affinity.push_back(lists.substr(pos, end - pos)); }
+                pos = end + 1;
+            }
+        }
+    } // namespace
+
+    void configure(const config_t& config)
+    {
+        if (is_running) { SMOL_LOG_WARN("JOBS", "Job system is already running, config applies on the next init"); }
+
+        pending_config = config;
+    }
+
     void init()
     {
         if (is_running) { return; }
 
-        is_running = true;
+        config_t config = pending_config;
+        read_env_count("SMOL_JOBS_HIGH_WORKERS", config.high_workers);
+        read_env_count("SMOL_JOBS_LOW_WORKERS", config.low_workers);
+        read_env_affinity("SMOL_JOBS_HIGH_AFFINITY", config.high_affinity);
+        read_env_affinity("SMOL_JOBS_LOW_AFFINITY", config.low_affinity);
 
         u32_t cores = std::thread::hardware_concurrency();
-        u32_t num_high = std::max(1u, cores - 1);
+        u32_t num_high = config.high_workers ? config.high_workers : std::max(1u, cores - 1);
+        u32_t num_low = std::max(1u, config.low_workers); // assets and general io
 
-        for (u32_t i = 0; i < num_high; i++)
-        {
-            high_priority_workers.emplace_back(worker_loop, std::ref(high_priority_queue));
-        }
+        is_running = true;
 
-        low_priority_worker = std::thread(worker_loop, std::ref(low_priority_queue));
+        // the calling (main) thread owns the last high priority deque so it can push without locking
+        start_pool(high_priority_pool, num_high, num_high + 1, config.high_name, config.high_affinity);
+        start_pool(low_priority_pool, num_low, num_low, config.low_name, config.low_affinity);
+
+        bind_thread(high_priority_pool, num_high);
+
+        SMOL_LOG_INFO("JOBS", "Started {} high and {} low priority workers", num_high, num_low);
     }
 
     void shutdown()
     {
         is_running = false;
 
-        high_priority_queue.wake_cv.notify_all();
-        low_priority_queue.wake_cv.notify_all();
-
-        for (std::thread& worker : high_priority_workers)
-        {
-            if (worker.joinable()) { worker.join(); }
-        }
-        high_priority_workers.clear();
+        stop_pool(high_priority_pool);
+        stop_pool(low_priority_pool);
 
-        if (low_priority_worker.joinable()) { low_priority_worker.join(); }
+        unbind_thread();
     }
 
-    // job stealing for main thread
-    void wait(counter_t* counter)
+    // job stealing for main thread, workers waiting on something also help with their own pool so a low priority
+    // job waiting on other low priority jobs can't deadlock the io worker
+    void wait(counter_t* counter, bool run_low_priority)
     {
         if (!counter) { return; }
 
-        while (counter->load(std::memory_order_acquire) > 0)
+        bool help_low = run_low_priority || tls_pool == &low_priority_pool;
+        u32_t idle_spins = 0;
+
+        while (!counter->is_done())
         {
             job_t job;
-            if (high_priority_queue.pop(job))
+            if (find_job(high_priority_pool, job))
+            {
+                run_job(high_priority_pool, job);
+                idle_spins = 0;
+                continue;
+            }
+
+            if (help_low && find_job(low_priority_pool, job))
+            {
+                run_job(low_priority_pool, job);
+                idle_spins = 0;
+                continue;
+            }
+
+            if (idle_spins < WAIT_SPINS)
+            {
+                idle_spins++;
+                cpu_relax();
+                continue;
+            }
+
+            // workers keep helping so jobs we are waiting on can't get stuck behind them, everyone else sleeps on
+            // the counter until it drains
+            i32_t value = counter->load(std::memory_order_acquire);
+            if (!tls_is_worker && value > 0)
             {
-                if (job.task) { job.task(); }
-                if (job.counter) { job.counter->fetch_sub(1, std::memory_order_release); }
+                u64_t idle_start = stats_now();
+                record_park(high_priority_pool);
+                counter->wait(value, std::memory_order_acquire);
+                record_idle(high_priority_pool, idle_start);
             }
             else
             {
                 std::this_thread::yield();
             }
         }
+    }
+
+    u32_t get_worker_count() { return static_cast<u32_t>(high_priority_pool.threads.size()); }
 
-        counter->store(0, std::memory_order_relaxed);
+    linear_allocator_t& scratch()
+    {
+        if (tls_scratch.get_capacity() == 0) { tls_scratch.init(SCRATCH_CAPACITY); }
+
+        return tls_scratch;
     }
 
-    u32_t get_worker_count() { return static_cast<u32_t>(high_priority_workers.size()); }
+    void begin_frame()
+    {
+        scratch_frame.fetch_add(1, std::memory_order_relaxed);
+
+        tls_scratch.reset();
+        tls_scratch_frame = scratch_frame.load(std::memory_order_relaxed);
+    }
+
+    namespace
+    {
+        pool_stats_t collect_pool_stats(worker_pool_t& pool)
+        {
+            pool_stats_t stats;
+
+#ifdef SMOL_ENABLE_JOB_STATS
+            stats.max_injector_depth = pool.max_injector_depth.load(std::memory_order_relaxed);
+
+            for (const std::unique_ptr<worker_counters_t>& counters : pool.counters)
+            {
+                worker_stats_t& worker = stats.workers.emplace_back();
+                worker.jobs_executed = counters->jobs_executed.load(std::memory_order_relaxed);
+                worker.steals = counters->steals.load(std::memory_order_relaxed);
+                worker.idle_ns = counters->idle_ns.load(std::memory_order_relaxed);
+                worker.parks = counters->parks.load(std::memory_order_relaxed);
+                worker.unparks = counters->unparks.load(std::memory_order_relaxed);
+                worker.max_queue_depth = counters->max_queue_depth.load(std::memory_order_relaxed);
+                worker.queue_wait_ns = counters->queue_wait_ns.load(std::memory_order_relaxed);
+
+                for (u32_t i = 0; i < QUEUE_WAIT_BUCKETS; i++)
+                { worker.queue_wait_histogram[i] = counters->queue_wait_histogram[i].load(std::memory_order_relaxed); }
+            }
+#else
+            stats.workers.resize(pool.deques.size() + 1);
+#endif
+
+            return stats;
+        }
+
+        void reset_pool_stats(worker_pool_t& pool)
+        {
+#ifdef SMOL_ENABLE_JOB_STATS
+            pool.max_injector_depth.store(0, std::memory_order_relaxed);
+
+            for (const std::unique_ptr<worker_counters_t>& counters : pool.counters)
+            {
+                counters->jobs_executed.store(0, std::memory_order_relaxed);
+                counters->steals.store(0, std::memory_order_relaxed);
+                counters->idle_ns.store(0, std::memory_order_relaxed);
+                counters->parks.store(0, std::memory_order_relaxed);
+                counters->unparks.store(0, std::memory_order_relaxed);
+                counters->max_queue_depth.store(0, std::memory_order_relaxed);
+                counters->frame_max_queue_depth.store(0, std::memory_order_relaxed);
+                counters->queue_wait_ns.store(0, std::memory_order_relaxed);
+
+                for (std::atomic<u64_t>& bucket : counters->queue_wait_histogram)
+                { bucket.store(0, std::memory_order_relaxed); }
+            }
+#else
+            (void)pool;
+#endif
+        }
+    } // namespace
+
+    stats_t get_stats() { return {collect_pool_stats(high_priority_pool), collect_pool_stats(low_priority_pool)}; }
+
+    void reset_stats()
+    {
+        reset_pool_stats(high_priority_pool);
+        reset_pool_stats(low_priority_pool);
+    }
+
+    void plot_stats()
+    {
+#if defined(SMOL_ENABLE_JOB_STATS) && defined(SMOL_ENABLE_PROFILING)
+        // the counters only ever grow, tracy gets the difference since last frame
+        static worker_stats_t last_totals;
+
+        worker_stats_t totals;
+        u32_t frame_max_depth = 0;
+
+        for (worker_pool_t* pool : {&high_priority_pool, &low_priority_pool})
+        {
+            for (const std::unique_ptr<worker_counters_t>& counters : pool->counters)
+            {
+                totals.jobs_executed += counters->jobs_executed.load(std::memory_order_relaxed);
+                totals.steals += counters->steals.load(std::memory_order_relaxed);
+                totals.idle_ns += counters->idle_ns.load(std::memory_order_relaxed);
+                totals.parks += counters->parks.load(std::memory_order_relaxed);
+                totals.unparks += counters->unparks.load(std::memory_order_relaxed);
+                totals.queue_wait_ns += counters->queue_wait_ns.load(std::memory_order_relaxed);
+
+                frame_max_depth = std::max(frame_max_depth,
+                                           counters->frame_max_queue_depth.exchange(0, std::memory_order_relaxed));
+            }
+        }
+
+        // reset_stats() in between would make the deltas go negative, start over from the new totals instead
+        if (totals.jobs_executed < last_totals.jobs_executed) { last_totals = {}; }
+
+        u64_t executed = totals.jobs_executed - last_totals.jobs_executed;
+        u64_t queue_wait_ns = totals.queue_wait_ns - last_totals.queue_wait_ns;
+
+        TracyPlot("jobs executed", static_cast<i64_t>(executed));
+        TracyPlot("jobs stolen", static_cast<i64_t>(totals.steals - last_totals.steals));
+        TracyPlot("jobs idle ms", static_cast<f64>(totals.idle_ns - last_totals.idle_ns) / 1e6);
+        TracyPlot("jobs parks", static_cast<i64_t>(totals.parks - last_totals.parks));
+        TracyPlot("jobs unparks", static_cast<i64_t>(totals.unparks - last_totals.unparks));
+        TracyPlot("jobs max queue depth", static_cast<i64_t>(frame_max_depth));
+        TracyPlot("jobs queue wait us", executed ? static_cast<f64>(queue_wait_ns) / executed / 1e3 : 0.0);
+
+        last_totals = totals;
+#endif
+    }
 } // namespace smol::jobs
\ No newline at end of file
@@ -1,17 +1,49 @@
 #pragma once
 
 #include "smol/defines.h"
+#include "smol/memory/linear_allocator.h"
+#include "smol/memory/slab_allocator.h"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
 #include <cstring>
 #include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <new>
+#include <span>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 namespace smol::jobs
 {
+    namespace detail
+    {
+        struct continuation_t;
+
+        // a counter sitting at zero has its continuation list closed, anything attached after that runs right away
+        inline continuation_t* closed_continuations() { return reinterpret_cast<continuation_t*>(uintptr_t(1)); }
+    } // namespace detail
+
     struct counter_t : std::atomic<i32_t>
     {
-        counter_t(i32_t v = 0) : std::atomic<i32_t>(v) {}
+        counter_t(i32_t v = 0)
+            : std::atomic<i32_t>(v), continuations(v > 0 ? nullptr : detail::closed_continuations())
+        {
+        }
+
+        // jobs queued with kick_after(), kicked by whoever brings the counter down to zero
+        std::atomic<detail::continuation_t*> continuations;
+
+        // the list is closed after the count hits zero, so once this is true the releasing thread is done with us
+        bool is_done() const
+        {
+            return load(std::memory_order_acquire) <= 0 &&
+                   continuations.load(std::memory_order_acquire) == detail::closed_continuations();
+        }
     };
 
     enum class priority_e
@@ -20,7 +52,14 @@ namespace smol::jobs
         HIGH // everything else basically
     };
 
-    template <size_t Capacity = 64>
+    // captures up to this size are stored in the queued job itself, bigger ones spill into the slab allocator. every
+    // job slot in the deques carries this many bytes, so raising it trades queue memory for fewer spills
+#ifndef SMOL_JOB_INLINE_CAPACITY
+#define SMOL_JOB_INLINE_CAPACITY 64
+#endif
+    constexpr size_t JOB_INLINE_CAPACITY = SMOL_JOB_INLINE_CAPACITY;
+
+    template <size_t Capacity = JOB_INLINE_CAPACITY>
     struct job_function
     {
         alignas(16) u8_t storage[Capacity];
@@ -34,6 +73,7 @@ namespace smol::jobs
             using decayed_lambda_t = std::decay_t<Lambda>;
 
             static_assert(sizeof(decayed_lambda_t) <= Capacity, "Job lambda capture is too big");
+            static_assert(alignof(decayed_lambda_t) <= 16, "Job lambda capture is over aligned");
             static_assert(
                 std::is_trivially_copyable_v<decayed_lambda_t>,
                 "Job lambdas can't capture STL containers or heavy objects by value, use kick_heavy() instead");
@@ -53,33 +93,95 @@ namespace smol::jobs
 
     namespace detail
     {
-        void push_job(job_function<64> task, counter_t* counter, priority_e prio);
-        void wake_threads(priority_e prio, bool wake_all);
+        template <typename Lambda>
+        constexpr bool fits_inline_v = sizeof(std::decay_t<Lambda>) <= JOB_INLINE_CAPACITY &&
+                                       alignof(std::decay_t<Lambda>) <= 16 &&
+                                       std::is_trivially_copyable_v<std::decay_t<Lambda>>;
+
+        // small trivially copyable lambdas are copied into the job as is, anything else is moved into a slab block
+        // that the job destroys and frees once it ran
+        template <typename Lambda>
+        job_function<> make_job(Lambda&& task)
+        {
+            using decayed_lambda_t = std::decay_t<Lambda>;
+
+            if constexpr (fits_inline_v<Lambda>) { return job_function<>(std::forward<Lambda>(task)); }
+            else
+            {
+                void* memory = slab::allocate(sizeof(decayed_lambda_t), alignof(decayed_lambda_t));
+                decayed_lambda_t* payload = new (memory) decayed_lambda_t(std::forward<Lambda>(task));
+
+                auto spilled_job = [payload]()
+                {
+                    (*payload)();
+                    payload->~decayed_lambda_t();
+                    slab::free(payload, sizeof(decayed_lambda_t), alignof(decayed_lambda_t));
+                };
+
+                return job_function<>(spilled_job);
+            }
+        }
+
+        SMOL_ENGINE_API void push_job(job_function<> task, counter_t* counter, priority_e prio);
+        SMOL_ENGINE_API void push_jobs(job_function<>* tasks, u32_t count, counter_t* counter, priority_e prio);
+        SMOL_ENGINE_API void wake_threads(priority_e prio, bool wake_all);
+
+        SMOL_ENGINE_API void add_ref(counter_t* counter, i32_t count);
+        SMOL_ENGINE_API void release_ref(counter_t* counter);
+        SMOL_ENGINE_API priority_e current_priority();
+        SMOL_ENGINE_API void push_continuation(counter_t* const* dependencies, u32_t dependency_count,
+                                               job_function<> task, counter_t* counter, priority_e prio);
+
+        // index of the calling thread's deque in the pool, threads outside the pool all share the last slot
+        SMOL_ENGINE_API u32_t worker_slot(priority_e prio);
+        SMOL_ENGINE_API u32_t worker_slot_count(priority_e prio);
     } // namespace detail
 
+    // captures bigger than JOB_INLINE_CAPACITY still work, they just cost a slab allocation
     template <typename Lambda>
     void kick(Lambda&& task, counter_t* counter = nullptr, priority_e prio = priority_e::HIGH)
     {
-        if (counter) { counter->fetch_add(1, std::memory_order_relaxed); }
+        static_assert(std::is_trivially_copyable_v<std::decay_t<Lambda>>,
+                      "Job lambdas can't capture STL containers or heavy objects by value, use kick_heavy() instead");
+
+        if (counter) { detail::add_ref(counter, 1); }
 
-        detail::push_job(std::forward<Lambda>(task), counter, prio);
+        detail::push_job(detail::make_job(std::forward<Lambda>(task)), counter, prio);
         detail::wake_threads(prio, false);
     }
 
+    // for captures that own memory (strings, vectors...), the lambda lives in a slab block until the job ran
     template <typename Lambda>
     void kick_heavy(Lambda&& task, counter_t* counter = nullptr, priority_e prio = priority_e::HIGH)
     {
-        using decayed_lambda_t = std::decay_t<Lambda>;
-        decayed_lambda_t* payload = new decayed_lambda_t(std::forward<Lambda>(task));
+        if (counter) { detail::add_ref(counter, 1); }
 
-        auto wrapper_job = [payload]()
+        detail::push_job(detail::make_job(std::forward<Lambda>(task)), counter, prio);
+        detail::wake_threads(prio, false);
+    }
+
+    // kicks count jobs, make_task(i) returns the lambda for job i. jobs are pushed in chunks with a single wake at the
+    // end, cheaper than kicking one by one when a caller already has a whole batch at hand
+    template <typename Factory>
+    void kick_batch(u32_t count, Factory&& make_task, counter_t* counter = nullptr,
+                    priority_e prio = priority_e::HIGH)
+    {
+        if (count == 0) { return; }
+
+        constexpr u32_t CHUNK_SIZE = 32;
+        job_function<> chunk[CHUNK_SIZE];
+
+        if (counter) { detail::add_ref(counter, static_cast<i32_t>(count)); }
+
+        for (u32_t first = 0; first < count; first += CHUNK_SIZE)
         {
-            (*payload)();
-            delete payload;
-        };
+            u32_t chunk_count = std::min(CHUNK_SIZE, count - first);
+            for (u32_t i = 0; i < chunk_count; i++) { chunk[i] = detail::make_job(make_task(first + i)); }
 
-        detail::push_job(job_function<64>(wrapper_job), counter, prio);
-        detail::wake_threads(prio, false);
+            detail::push_jobs(chunk, chunk_count, counter, prio);
+        }
+
+        detail::wake_threads(prio, count > 1);
     }
 
     template <typename Lambda>
@@ -90,7 +192,7 @@ namespace smol::jobs
 
         u32_t job_count = (count + batch_size - 1) / batch_size;
 
-        if (counter) { counter->fetch_add(job_count, std::memory_order_relaxed); }
+        if (counter) { detail::add_ref(counter, static_cast<i32_t>(job_count)); }
 
         for (u32_t i = 0; i < count; i += batch_size)
         {
@@ -99,16 +201,205 @@ namespace smol::jobs
 
             auto batch_task = [task, start, end]() { task(start, end); };
 
-            detail::push_job(job_function<64>(batch_task), counter, priority);
+            detail::push_job(detail::make_job(batch_task), counter, priority);
         }
 
         detail::wake_threads(priority, priority == priority_e::HIGH);
     }
 
-    void init();
-    void shutdown();
+    // kicks task once every dependency counter has dropped to zero, counter is incremented right away so waiting
+    // on it also covers the deferred job. dependencies have to be kicked before the continuation is attached
+    template <typename Lambda>
+    void kick_after(std::initializer_list<counter_t*> dependencies, Lambda&& task, counter_t* counter = nullptr,
+                    priority_e prio = priority_e::HIGH)
+    {
+        if (counter) { detail::add_ref(counter, 1); }
+
+        detail::push_continuation(dependencies.begin(), static_cast<u32_t>(dependencies.size()),
+                                  detail::make_job(std::forward<Lambda>(task)), counter, prio);
+    }
+
+    template <typename Lambda>
+    void kick_after(std::span<counter_t* const> dependencies, Lambda&& task, counter_t* counter = nullptr,
+                    priority_e prio = priority_e::HIGH)
+    {
+        if (counter) { detail::add_ref(counter, 1); }
+
+        detail::push_continuation(dependencies.data(), static_cast<u32_t>(dependencies.size()),
+                                  detail::make_job(std::forward<Lambda>(task)), counter, prio);
+    }
+
+    template <typename Lambda>
+    void kick_after(counter_t* dependency, Lambda&& task, counter_t* counter = nullptr,
+                    priority_e prio = priority_e::HIGH)
+    { kick_after({dependency}, std::forward<Lambda>(task), counter, prio); }
+
+    // worker topology, takes effect on the next init(). SMOL_JOBS_HIGH_WORKERS, SMOL_JOBS_LOW_WORKERS,
+    // SMOL_JOBS_HIGH_AFFINITY and SMOL_JOBS_LOW_AFFINITY in the environment override whatever was configured
+    struct config_t
+    {
+        u32_t high_workers = 0; // 0 picks one per hardware thread, minus the main thread
+        u32_t low_workers = 1;
+
+        // cpu lists in taskset syntax ("0-7,16"), entry i pins worker i and the list wraps around so a single entry
+        // pins the whole pool. empty leaves scheduling to the os, only applied on linux
+        std::vector<std::string> high_affinity;
+        std::vector<std::string> low_affinity;
+
+        // workers are named "<name>-<index>" for debuggers and tracy, linux cuts thread names at 15 characters
+        std::string high_name = "smol-high";
+        std::string low_name = "smol-low";
+    };
+
+    SMOL_ENGINE_API void configure(const config_t& config);
+
+    SMOL_ENGINE_API void init();
+    SMOL_ENGINE_API void shutdown();
+
+    constexpr u32_t QUEUE_WAIT_BUCKETS = 16;
+
+    // one per deque slot of a pool, the last slot collects threads that don't own a deque there (foreign threads
+    // helping out in wait()). everything reads zero when the engine is built without SMOL_ENABLE_JOB_STATS
+    struct worker_stats_t
+    {
+        u64_t jobs_executed = 0;
+        u64_t steals = 0;
+        u64_t idle_ns = 0;
+        u64_t parks = 0;   // times the thread went to sleep
+        u64_t unparks = 0; // wake syscalls the thread issued for sleeping workers
+        u32_t max_queue_depth = 0;
+
+        // time between a push and the job starting, bucket 0 is under 1us, bucket i covers [2^(i-1), 2^i) us and
+        // the last one everything slower
+        u64_t queue_wait_ns = 0;
+        std::array<u64_t, QUEUE_WAIT_BUCKETS> queue_wait_histogram{};
+    };
+
+    struct pool_stats_t
+    {
+        std::vector<worker_stats_t> workers;
+        u32_t max_injector_depth = 0;
+    };
+
+    struct stats_t
+    {
+        pool_stats_t high;
+        pool_stats_t low;
+    };
+
+    SMOL_ENGINE_API stats_t get_stats();
+    SMOL_ENGINE_API void reset_stats();
+
+    // frame deltas of the counters as tracy plots, no-op unless both profiling and job stats are compiled in
+    SMOL_ENGINE_API void plot_stats();
+
+    // per thread arena for job temporaries, memory stays valid until the frame it was allocated in is over. workers
+    // reset theirs between jobs once a new frame started, the main thread in begin_frame(). other threads own their
+    // arena and have to reset it themselves. get_marker()/rewind() hand memory back early
+    SMOL_ENGINE_API linear_allocator_t& scratch();
 
-    SMOL_ENGINE_API void wait(counter_t* counter);
+    // frame boundary for the scratch arenas, called by the engine at the top of every frame
+    SMOL_ENGINE_API void begin_frame();
 
+    // helps with high priority jobs until counter drains, run_low_priority also lets the caller pick up io work
+    SMOL_ENGINE_API void wait(counter_t* counter, bool run_low_priority = false);
     SMOL_ENGINE_API u32_t get_worker_count();
+
+    namespace detail
+    {
+        // a range stolen by another worker gets this many extra splits, the thief is idle so more work is wanted
+        constexpr u32_t STOLEN_SPLIT_DEPTH = 2;
+
+        // enough splits for about four chunks per thread before anything gets stolen
+        inline u32_t initial_split_depth() { return std::bit_width(4u * (get_worker_count() + 1) - 1); }
+
+        template <typename Body>
+        void run_range(Body* body, u32_t start, u32_t end, u32_t grain, u32_t depth, u32_t owner, counter_t* counter,
+                       priority_e prio)
+        {
+            u32_t slot = worker_slot(prio);
+            if (slot != owner) { depth += STOLEN_SPLIT_DEPTH; }
+
+            // keep halving, the upper half goes on our deque where idle workers can steal it
+            bool has_split = false;
+            while (depth > 0 && end - start > grain)
+            {
+                u32_t mid = start + (end - start) / 2;
+                depth--;
+
+                auto split_task = [body, mid, end, grain, depth, slot, counter, prio]()
+                { run_range(body, mid, end, grain, depth, slot, counter, prio); };
+
+                add_ref(counter, 1);
+                push_job(make_job(split_task), counter, prio);
+
+                end = mid;
+                has_split = true;
+            }
+
+            if (has_split) { wake_threads(prio, false); }
+
+            (*body)(start, end);
+        }
+    } // namespace detail
+
+    // runs body(start, end) over [begin, end) and returns once every chunk is done. the range is split lazily in
+    // halves, stolen pieces keep splitting so uneven work balances itself. grain is the smallest range worth a job
+    template <typename Body>
+    void parallel_for(u32_t begin, u32_t end, Body&& body, u32_t grain = 0, priority_e prio = priority_e::HIGH)
+    {
+        if (begin >= end) { return; }
+
+        grain = std::max(grain, 1u);
+
+        counter_t counter(1);
+        detail::run_range(&body, begin, end, grain, detail::initial_split_depth(), detail::worker_slot(prio),
+                          &counter, prio);
+        detail::release_ref(&counter);
+
+        wait(&counter);
+    }
+
+    // body(start, end, acc) folds a chunk into acc, partial results are merged with join(a, b) in no particular
+    // order so join has to be associative and commutative (sums, min/max, aabb merges)
+    template <typename T, typename Body, typename Join>
+    T parallel_reduce(u32_t begin, u32_t end, const T& identity, Body&& body, Join&& join, u32_t grain = 0,
+                      priority_e prio = priority_e::HIGH)
+    {
+        struct alignas(64) partial_t
+        {
+            T value;
+        };
+
+        u32_t slot_count = detail::worker_slot_count(prio);
+        u32_t shared_slot = slot_count - 1;
+
+        std::vector<partial_t> partials(slot_count, partial_t{identity});
+        std::mutex shared_mutex;
+
+        // chunks fold into a local first, a nested wait() inside body may run another chunk on this same slot
+        auto reduce_range = [&](u32_t start, u32_t stop)
+        {
+            T local = identity;
+            body(start, stop, local);
+
+            u32_t slot = detail::worker_slot(prio);
+            if (slot == shared_slot)
+            {
+                std::scoped_lock lock(shared_mutex);
+                partials[slot].value = join(partials[slot].value, local);
+            }
+            else
+            {
+                partials[slot].value = join(partials[slot].value, local);
+            }
+        };
+
+        parallel_for(begin, end, reduce_range, grain, prio);
+
+        T result = identity;
+        for (partial_t& partial : partials) { result = join(result, partial.value); }
+
+        return result;
+    }
 } // namespace smol::jobs
\ No newline at end of file
@@ -0,0 +1,249 @@
+#pragma once
+
+#include "smol/jobs.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace smol::jobs
+{
+    template <typename T = void>
+    class task;
+
+    namespace detail
+    {
+        struct task_promise_base_t
+        {
+            std::coroutine_handle<> continuation;
+
+            struct final_awaiter_t
+            {
+                bool await_ready() const noexcept { return false; }
+
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    std::coroutine_handle<> next = handle.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            final_awaiter_t final_suspend() const noexcept { return {}; }
+
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        template <typename T>
+        struct task_promise_t : task_promise_base_t
+        {
+            std::optional<T> value;
+
+            task<T> get_return_object();
+
+            template <typename U>
+            void return_value(U&& result)
+            { value.emplace(std::forward<U>(result)); }
+        };
+
+        template <>
+        struct task_promise_t<void> : task_promise_base_t
+        {
+            task<void> get_return_object();
+
+            void return_void() {}
+        };
+
+        // fire and forget coroutine frame, destroys itself when it runs off the end
+        struct detached_task_t
+        {
+            struct promise_type
+            {
+                detached_task_t get_return_object()
+                { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+
+                std::suspend_always initial_suspend() const noexcept { return {}; }
+                std::suspend_never final_suspend() const noexcept { return {}; }
+
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); }
+            };
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        inline void resume_on_worker(std::coroutine_handle<> handle, priority_e prio)
+        { kick([handle]() { handle.resume(); }, nullptr, prio); }
+
+        template <typename T>
+        detached_task_t run_detached(task<T> t, counter_t* counter)
+        {
+            co_await t;
+            if (counter) { release_ref(counter); }
+        }
+
+        // the task itself stays owned by the caller, used by when_all() to keep results around
+        template <typename T>
+        detached_task_t run_borrowed(task<T>& t, counter_t* counter)
+        {
+            co_await t;
+            release_ref(counter);
+        }
+    } // namespace detail
+
+    // lazily started coroutine, nothing runs until it is co_awaited or handed to spawn()
+    template <typename T>
+    class [[nodiscard]] task
+    {
+      public:
+        using promise_type = detail::task_promise_t<T>;
+
+        task() = default;
+        explicit task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+        task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+        task& operator=(task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle) { handle.destroy(); }
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        task(const task&) = delete;
+        task& operator=(const task&) = delete;
+
+        ~task()
+        {
+            if (handle) { handle.destroy(); }
+        }
+
+        bool is_done() const { return !handle || handle.done(); }
+
+        auto operator co_await() noexcept
+        {
+            struct awaiter_t
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() const noexcept { return !handle || handle.done(); }
+
+                // runs the child inline on the current worker, it resumes us once it is done
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                auto await_resume()
+                {
+                    if constexpr (!std::is_void_v<T>) { return std::move(*handle.promise().value); }
+                }
+            };
+
+            return awaiter_t{handle};
+        }
+
+      private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        task<T> task_promise_t<T>::get_return_object()
+        { return task<T>(std::coroutine_handle<task_promise_t<T>>::from_promise(*this)); }
+
+        inline task<void> task_promise_t<void>::get_return_object()
+        { return task<void>(std::coroutine_handle<task_promise_t<void>>::from_promise(*this)); }
+
+        struct counter_awaiter_t
+        {
+            counter_t* counter;
+            priority_e prio;
+
+            bool await_ready() const noexcept { return counter->is_done(); }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            { kick_after(counter, [handle]() { handle.resume(); }, nullptr, prio); }
+
+            void await_resume() const noexcept {}
+        };
+    } // namespace detail
+
+    // suspends until the counter reaches zero, then resumes on a worker of the current thread's pool
+    inline detail::counter_awaiter_t operator co_await(counter_t& counter)
+    { return {&counter, detail::current_priority()}; }
+
+    // starts a task on a worker without anyone awaiting it, counter drops once it has finished
+    template <typename T>
+    void spawn(task<T> t, counter_t* counter = nullptr, priority_e prio = priority_e::HIGH)
+    {
+        if (counter) { detail::add_ref(counter, 1); }
+
+        detail::resume_on_worker(detail::run_detached(std::move(t), counter).handle, prio);
+    }
+
+    // same as spawn but the calling thread runs the task up to its first suspension, it picks up on a worker from
+    // there
+    template <typename T>
+    void spawn_inline(task<T> t, counter_t* counter = nullptr)
+    {
+        if (counter) { detail::add_ref(counter, 1); }
+
+        detail::run_detached(std::move(t), counter).handle.resume();
+    }
+
+    // runs every task in parallel on the workers and resumes once all of them are done
+    inline task<void> when_all(std::vector<task<void>> tasks)
+    {
+        counter_t counter;
+        priority_e prio = detail::current_priority();
+
+        // every ref is taken up front, a task finishing early must not see the counter hit zero
+        detail::add_ref(&counter, static_cast<i32_t>(tasks.size()));
+        for (task<void>& t : tasks) { detail::resume_on_worker(detail::run_borrowed(t, &counter).handle, prio); }
+
+        co_await counter;
+    }
+
+    template <typename T>
+    task<std::vector<T>> when_all(std::vector<task<T>> tasks)
+    {
+        counter_t counter;
+        priority_e prio = detail::current_priority();
+
+        // every ref is taken up front, a task finishing early must not see the counter hit zero
+        detail::add_ref(&counter, static_cast<i32_t>(tasks.size()));
+        for (task<T>& t : tasks) { detail::resume_on_worker(detail::run_borrowed(t, &counter).handle, prio); }
+
+        co_await counter;
+
+        std::vector<T> results;
+        results.reserve(tasks.size());
+        for (task<T>& t : tasks) { results.push_back(co_await t); }
+
+        co_return results;
+    }
+
+    // mixed result types, the tasks stay with the caller and co_awaiting them afterwards hands out the results
+    template <typename... Ts>
+    task<void> when_all(task<Ts>&... tasks)
+    {
+        counter_t counter;
+        priority_e prio = detail::current_priority();
+
+        detail::add_ref(&counter, static_cast<i32_t>(sizeof...(Ts)));
+        (detail::resume_on_worker(detail::run_borrowed(tasks, &counter).handle, prio), ...);
+
+        co_await counter;
+    }
+} // namespace smol::jobs
\ No newline at end of file
@@ -28,5 +28,16 @@ namespace smol
 
     void linear_allocator_t::reset() { cur_offset = 0; }
 
+    void linear_allocator_t::rewind(size_t marker)
+    {
+        if (marker > cur_offset)
+        {
+            SMOL_LOG_ERROR("MEMORY", "Rewind past the current offset, marker: {}, offset: {}", marker, cur_offset);
+            return;
+        }
+
+        cur_offset = marker;
+    }
+
     thread_local linear_allocator_t* active_arena = nullptr;
 } // namespace smol
\ No newline at end of file
@@ -16,6 +16,10 @@ namespace smol
         void* allocate(size_t size, size_t alignment = 16);
         void reset();
 
+        // everything allocated after the marker is handed back by rewind(), older allocations stay valid
+        size_t get_marker() const { return cur_offset; }
+        void rewind(size_t marker);
+
         size_t get_capacity() const { return buffer.size(); }
     };
 
@@ -0,0 +1,149 @@
+#include "slab_allocator.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace smol::slab
+{
+    namespace
+    {
+        constexpr u32_t CLASS_COUNT = std::bit_width(MAX_BLOCK_SIZE / MIN_BLOCK_SIZE);
+        constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+        // blocks moved between a thread cache and the shared pool at once
+        constexpr u32_t TRANSFER_BATCH = 32;
+
+        struct free_block_t
+        {
+            free_block_t* next;
+        };
+
+        struct free_list_t
+        {
+            free_block_t* head = nullptr;
+            u32_t count = 0;
+
+            void push(free_block_t* block)
+            {
+                block->next = head;
+                head = block;
+                count++;
+            }
+
+            free_block_t* pop()
+            {
+                free_block_t* block = head;
+                head = block->next;
+                count--;
+                return block;
+            }
+        };
+
+        struct shared_class_t
+        {
+            std::mutex mutex;
+            free_list_t blocks;
+        };
+
+        struct chunk_deleter_t
+        {
+            void operator()(u8_t* chunk) const { ::operator delete(chunk, std::align_val_t(BLOCK_ALIGNMENT)); }
+        };
+
+        std::array<shared_class_t, CLASS_COUNT> shared_classes;
+
+        std::mutex chunks_mutex;
+        std::vector<std::unique_ptr<u8_t, chunk_deleter_t>> chunks;
+
+        u32_t get_class(size_t size)
+        { return static_cast<u32_t>(std::bit_width((std::max(size, MIN_BLOCK_SIZE) - 1) / MIN_BLOCK_SIZE)); }
+
+        size_t get_block_size(u32_t size_class) { return MIN_BLOCK_SIZE << size_class; }
+
+        // carves a fresh chunk into blocks of one class, they go straight into the caller's list
+        void carve_chunk(u32_t size_class, free_list_t& out_list)
+        {
+            u8_t* chunk = static_cast<u8_t*>(::operator new(CHUNK_SIZE, std::align_val_t(BLOCK_ALIGNMENT)));
+
+            {
+                std::scoped_lock lock(chunks_mutex);
+                chunks.emplace_back(chunk);
+            }
+
+            size_t block_size = get_block_size(size_class);
+            for (size_t offset = 0; offset + block_size <= CHUNK_SIZE; offset += block_size)
+            { out_list.push(reinterpret_cast<free_block_t*>(chunk + offset)); }
+        }
+
+        void return_blocks(u32_t size_class, free_list_t& list, u32_t count)
+        {
+            shared_class_t& shared = shared_classes[size_class];
+            std::scoped_lock lock(shared.mutex);
+
+            for (u32_t i = 0; i < count && list.head; i++) { shared.blocks.push(list.pop()); }
+        }
+
+        struct thread_cache_t
+        {
+            std::array<free_list_t, CLASS_COUNT> classes;
+
+            ~thread_cache_t()
+            {
+                for (u32_t i = 0; i < CLASS_COUNT; i++) { return_blocks(i, classes[i], classes[i].count); }
+            }
+
+            void refill(u32_t size_class)
+            {
+                free_list_t& list = classes[size_class];
+                shared_class_t& shared = shared_classes[size_class];
+
+                {
+                    std::scoped_lock lock(shared.mutex);
+                    for (u32_t i = 0; i < TRANSFER_BATCH && shared.blocks.head; i++) { list.push(shared.blocks.pop()); }
+                }
+
+                if (!list.head) { carve_chunk(size_class, list); }
+            }
+        };
+
+        thread_local thread_cache_t tls_cache;
+
+        bool is_slab_size(size_t size, size_t alignment) { return size <= MAX_BLOCK_SIZE && alignment <= BLOCK_ALIGNMENT; }
+    } // namespace
+
+    void* allocate(size_t size, size_t alignment)
+    {
+        if (!is_slab_size(size, alignment)) { return ::operator new(size, std::align_val_t(alignment)); }
+
+        u32_t size_class = get_class(size);
+        free_list_t& list = tls_cache.classes[size_class];
+
+        if (!list.head) { tls_cache.refill(size_class); }
+
+        return list.pop();
+    }
+
+    void free(void* ptr, size_t size, size_t alignment)
+    {
+        if (!ptr) { return; }
+
+        if (!is_slab_size(size, alignment))
+        {
+            ::operator delete(ptr, std::align_val_t(alignment));
+            return;
+        }
+
+        u32_t size_class = get_class(size);
+        free_list_t& list = tls_cache.classes[size_class];
+
+        list.push(static_cast<free_block_t*>(ptr));
+
+        // a thread that only ever frees (the consumer side of kick_heavy) would hoard blocks otherwise
+        if (list.count > 2 * TRANSFER_BATCH) { return_blocks(size_class, list, TRANSFER_BATCH); }
+    }
+} // namespace smol::slab
\ No newline at end of file
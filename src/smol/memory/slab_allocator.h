@@ -0,0 +1,18 @@
+#pragma once
+
+#include "smol/defines.h"
+
+#include <cstddef>
+
+namespace smol::slab
+{
+    // power of two size classes from 64 bytes up, anything bigger or more aligned goes to operator new
+    constexpr size_t MIN_BLOCK_SIZE = 64;
+    constexpr size_t MAX_BLOCK_SIZE = 4096;
+    constexpr size_t BLOCK_ALIGNMENT = 64;
+
+    // every thread keeps a free list per size class, the shared pool is only touched in batches when a thread
+    // runs dry or holds too much. blocks may be freed on a different thread than the one that allocated them
+    SMOL_ENGINE_API void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    SMOL_ENGINE_API void free(void* ptr, size_t size, size_t alignment = alignof(std::max_align_t));
+} // namespace smol::slab
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "Jolt/Core/JobSystem.h"
 #include "smol/jobs.h"
 
+#include <thread>
+
 namespace smol
 {
     int jolt_job_system_integration_t::GetMaxConcurrency() const { return (int)smol::jobs::get_worker_count(); }
@@ -12,8 +14,20 @@ namespace smol
                                                             const JPH::JobSystem::JobFunction& in_job_func,
                                                             JPH::uint32 in_num_deps)
     {
-        JPH::JobSystem::Job* job = new JPH::JobSystem::Job(in_name, in_color, this, in_job_func, in_num_deps);
+        JPH::uint32 index = jobs.ConstructObject(in_name, in_color, this, in_job_func, in_num_deps);
+        while (index == decltype(jobs)::cInvalidObjectIndex)
+        {
+            JPH_ASSERT(false, "Out of physics jobs, raise MAX_JOBS");
+            std::this_thread::yield();
+            index = jobs.ConstructObject(in_name, in_color, this, in_job_func, in_num_deps);
+        }
+
+        JPH::JobSystem::Job* job = &jobs.Get(index);
+
+        // the handle keeps a reference, a job without dependencies goes out right away and may finish before we return
         JPH::JobHandle handle(job);
+        if (in_num_deps == 0) { QueueJob(job); }
+
         return handle;
     }
 
@@ -31,8 +45,21 @@ namespace smol
 
     void jolt_job_system_integration_t::QueueJobs(JPH::JobSystem::Job** in_jobs, JPH::uint32 in_num_jobs)
     {
-        for (JPH::uint32 i = 0; i < in_num_jobs; i++) { QueueJob(in_jobs[i]); }
+        smol::jobs::kick_batch(
+            in_num_jobs,
+            [in_jobs](u32_t i)
+            {
+                JPH::JobSystem::Job* job = in_jobs[i];
+                job->AddRef();
+
+                return [job]()
+                {
+                    job->Execute();
+                    job->Release();
+                };
+            },
+            nullptr, smol::jobs::priority_e::HIGH);
     }
 
-    void jolt_job_system_integration_t::FreeJob(JPH::JobSystem::Job* in_job) { delete in_job; }
+    void jolt_job_system_integration_t::FreeJob(JPH::JobSystem::Job* in_job) { jobs.DestructObject(in_job); }
 } // namespace smol
\ No newline at end of file
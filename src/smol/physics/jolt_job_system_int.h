@@ -4,6 +4,7 @@
 #include <Jolt/Jolt.h>
 #include "Jolt/Core/Core.h"
 #include "Jolt/Core/JobSystem.h"
+#include <Jolt/Core/FixedSizeFreeList.h>
 #include <Jolt/Core/JobSystemWithBarrier.h>
 // clang-format on
 
@@ -12,7 +13,10 @@ namespace smol
     class jolt_job_system_integration_t : public JPH::JobSystemWithBarrier
     {
       public:
-        jolt_job_system_integration_t() : JPH::JobSystemWithBarrier(1024) {}
+        // same budget as jolt's own samples, a physics step creates a few jobs per body pair batch
+        static constexpr JPH::uint MAX_JOBS = 2048;
+
+        jolt_job_system_integration_t() : JPH::JobSystemWithBarrier(1024) { jobs.Init(MAX_JOBS, MAX_JOBS); }
 
         virtual int GetMaxConcurrency() const override;
         virtual JPH::JobHandle CreateJob(const char* in_name, JPH::ColorArg in_color,
@@ -21,5 +25,9 @@ namespace smol
         virtual void QueueJob(JPH::JobSystem::Job* in_job) override;
         virtual void QueueJobs(JPH::JobSystem::Job** in_jobs, JPH::uint32 in_num_jobs) override;
         virtual void FreeJob(JPH::JobSystem::Job* in_job) override;
+
+      private:
+        // lock free pool reused across steps, jolt frees jobs from whatever worker drops the last reference
+        JPH::FixedSizeFreeList<JPH::JobSystem::Job> jobs;
     };
 } // namespace smol
\ No newline at end of file
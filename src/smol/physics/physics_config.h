@@ -0,0 +1,52 @@
+#pragma once
+
+#include "smol/defines.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace smol::physics
+{
+    // layers are masked by a u32_t, one bit each
+    inline constexpr u32_t MAX_LAYERS = 32;
+
+    // rigidbody_t::layer value that picks the configured static or dynamic layer from the body type
+    inline constexpr u32_t AUTO_LAYER = ~0u;
+
+    struct object_layer_config_t
+    {
+        std::string name;
+        u32_t broad_phase = 0; // index into physics_config_t::broad_phase_layers
+        u32_t collides_with = 0; // bit i set collides with layers[i], made symmetric by configure()
+    };
+
+    // sizes are fixed for the lifetime of a world, jolt drops bodies and contacts past them. the defaults fit a
+    // few ten thousand bodies, get_stats() of a world shows how much of them a scene actually used
+    struct physics_config_t
+    {
+        u32_t max_bodies = 65536;
+        u32_t max_body_pairs = 65536;
+        u32_t max_contact_constraints = 10240;
+        u32_t temp_allocator_size = 10 * 1024 * 1024; // bytes, steps that need more fall back to the heap
+        u32_t collision_steps = 1;                     // per fixed step, raise for fast or small bodies
+
+        std::vector<std::string> broad_phase_layers = {"NON_MOVING", "MOVING"};
+        std::vector<object_layer_config_t> layers = {
+            {"NON_MOVING", 0, 1u << 1},
+            {"MOVING", 1, (1u << 0) | (1u << 1)},
+        };
+
+        // layers of rigidbodies left on AUTO_LAYER, kinematic bodies use the dynamic one
+        u32_t static_layer = 0;
+        u32_t dynamic_layer = 1;
+    };
+
+    // read by every world that is initialized afterwards, worlds that are already running keep their sizes.
+    // invalid layer setups are logged and replaced by the defaults
+    SMOL_ENGINE_API void configure(const physics_config_t& config);
+    SMOL_ENGINE_API const physics_config_t& get_config();
+
+    // index of the named layer in the current config for rigidbody_t::layer, AUTO_LAYER when there is none
+    SMOL_ENGINE_API u32_t find_layer(std::string_view name);
+} // namespace smol::physics
\ No newline at end of file
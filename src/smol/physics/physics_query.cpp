@@ -0,0 +1,352 @@
+#include "physics_query.h"
+
+// clang-format off
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Body/Body.h>
+#include <Jolt/Physics/Body/BodyFilter.h>
+#include <Jolt/Physics/Body/BodyLock.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseLayer.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/CollideShape.h>
+#include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
+#include <Jolt/Physics/Collision/NarrowPhaseQuery.h>
+#include <Jolt/Physics/Collision/ObjectLayer.h>
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Physics/Collision/Shape/SphereShape.h>
+#include <Jolt/Physics/Collision/ShapeCast.h>
+// clang-format on
+
+#include "smol/ecs.h"
+#include "smol/jobs.h"
+#include "smol/log.h"
+#include "smol/physics/physics_world.h"
+#include "smol/profiling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace smol::physics::query
+{
+    namespace
+    {
+        // a ray is a few microseconds of tree walk, one job per query would cost more than the query
+        constexpr u32_t QUERY_GRAIN = 16;
+
+        // jolt asserts on spheres without a radius, zero is still a useful point query so it gets a tiny one
+        constexpr f32 MIN_SPHERE_RADIUS = 1.0e-4f;
+
+        class layer_mask_filter_t final : public JPH::ObjectLayerFilter
+        {
+          public:
+            explicit layer_mask_filter_t(u32_t mask) : mask(mask) {}
+
+            virtual bool ShouldCollide(JPH::ObjectLayer inLayer) const override { return mask & (1u << inLayer); }
+
+          private:
+            u32_t mask;
+        };
+
+        // skips the broadphase trees that hold none of the masked layers
+        class broad_phase_mask_filter_t final : public JPH::BroadPhaseLayerFilter
+        {
+          public:
+            broad_phase_mask_filter_t(const physics_config_t& config, u32_t layer_mask)
+            {
+                for (size_t layer = 0; layer < config.layers.size(); layer++)
+                {
+                    if (layer_mask & (1u << layer)) { mask |= 1u << config.layers[layer].broad_phase; }
+                }
+            }
+
+            virtual bool ShouldCollide(JPH::BroadPhaseLayer inLayer) const override
+            { return mask & (1u << inLayer.GetValue()); }
+
+          private:
+            u32_t mask = 0;
+        };
+
+        class ignore_entity_filter_t final : public JPH::BodyFilter
+        {
+          public:
+            explicit ignore_entity_filter_t(ecs::entity_t entity) : user_data(entt::to_integral(entity)) {}
+
+            virtual bool ShouldCollideLocked(const JPH::Body& inBody) const override
+            { return inBody.GetUserData() != user_data; }
+
+          private:
+            JPH::uint64 user_data;
+        };
+
+        // bodies carry their entity in the user data, create_bodies puts it there
+        ecs::entity_t entity_of(const JPH::Body& body)
+        { return static_cast<ecs::entity_t>(static_cast<u32_t>(body.GetUserData())); }
+
+        // appends every body touched by an overlap, compound shapes can report one body more than once
+        class entity_collector_t final : public JPH::CollideShapeCollector
+        {
+          public:
+            entity_collector_t(const JPH::BodyLockInterface& locks, std::vector<ecs::entity_t>& out)
+                : locks(locks), out(out)
+            {
+            }
+
+            virtual void AddHit(const JPH::CollideShapeResult& inResult) override
+            {
+                JPH::BodyLockRead lock(locks, inResult.mBodyID2);
+                if (lock.Succeeded()) { out.push_back(entity_of(lock.GetBody())); }
+            }
+
+          private:
+            const JPH::BodyLockInterface& locks;
+            std::vector<ecs::entity_t>& out;
+        };
+
+        struct filters_t
+        {
+            broad_phase_mask_filter_t broad_phase;
+            layer_mask_filter_t layers;
+            ignore_entity_filter_t body;
+
+            filters_t(const physics_config_t& config, u32_t layer_mask, ecs::entity_t ignore)
+                : broad_phase(config, layer_mask), layers(layer_mask), body(ignore)
+            {
+            }
+        };
+
+        physics_world_t* get_physics(ecs::registry_t& reg)
+        {
+            physics_world_t** physics = reg.ctx().find<physics_world_t*>();
+            return physics ? *physics : nullptr;
+        }
+
+        JPH::Vec3 to_jolt(const vec3_t& v) { return {v.x, v.y, v.z}; }
+        JPH::Quat to_jolt(const quat_t& q) { return {q.x, q.y, q.z, q.w}; }
+        vec3_t from_jolt(JPH::Vec3Arg v) { return {v.GetX(), v.GetY(), v.GetZ()}; }
+
+        // zero length directions have nothing to sweep along, they come back as misses
+        JPH::Vec3 to_sweep(const vec3_t& direction, f32 max_distance)
+        {
+            JPH::Vec3 dir = to_jolt(direction);
+            f32 length = dir.Length();
+            return length > 0.0f ? dir * (max_distance / length) : JPH::Vec3::sZero();
+        }
+
+        f32 sphere_radius(f32 radius) { return std::max(std::abs(radius), MIN_SPHERE_RADIUS); }
+
+        bool has_results(const char* query, size_t count, size_t result_count)
+        {
+            if (result_count >= count) { return true; }
+            SMOL_LOG_ERROR("PHYSICS", "{} got {} queries but room for {} results, nothing was run", query, count,
+                           result_count);
+            return false;
+        }
+
+        template <typename Fn>
+        void run_batch(u32_t count, Fn&& fn)
+        {
+            jobs::parallel_for(
+                0, count,
+                [&fn](u32_t start, u32_t end)
+                {
+                    for (u32_t i = start; i < end; i++) { fn(i); }
+                },
+                QUERY_GRAIN);
+        }
+
+        void cast_shape(const physics_world_t& physics, const JPH::Shape& shape, const vec3_t& origin,
+                        const quat_t& rotation, const JPH::Vec3& sweep, const filters_t& filters, hit_t& out)
+        {
+            out = {};
+            if (sweep.IsNearZero()) { return; }
+
+            JPH::RShapeCast cast = JPH::RShapeCast::sFromWorldTransform(
+                &shape, JPH::Vec3::sReplicate(1.0f),
+                JPH::RMat44::sRotationTranslation(to_jolt(rotation), to_jolt(origin)), sweep);
+
+            JPH::ShapeCastSettings settings;
+            JPH::ClosestHitCollisionCollector<JPH::CastShapeCollector> collector;
+            physics.system.GetNarrowPhaseQueryNoLock().CastShape(cast, settings, JPH::RVec3::sZero(), collector,
+                                                                 filters.broad_phase, filters.layers, filters.body);
+            if (!collector.HadHit()) { return; }
+
+            const JPH::ShapeCastResult& hit = collector.mHit;
+            JPH::BodyLockRead lock(physics.system.GetBodyLockInterfaceNoLock(), hit.mBodyID2);
+            if (!lock.Succeeded()) { return; }
+
+            out.entity = entity_of(lock.GetBody());
+            out.distance = hit.mFraction * sweep.Length();
+            out.point = from_jolt(hit.mContactPointOn2);
+            out.normal = from_jolt(-hit.mPenetrationAxis.NormalizedOr(JPH::Vec3::sZero()));
+        }
+
+        void collide_shape(const physics_world_t& physics, const JPH::Shape& shape, const vec3_t& center,
+                           const quat_t& rotation, const filters_t& filters, std::vector<ecs::entity_t>& out)
+        {
+            out.clear();
+
+            JPH::CollideShapeSettings settings;
+            entity_collector_t collector(physics.system.GetBodyLockInterfaceNoLock(), out);
+            JPH::RMat44 transform = JPH::RMat44::sRotationTranslation(to_jolt(rotation), to_jolt(center));
+            physics.system.GetNarrowPhaseQueryNoLock().CollideShape(&shape, JPH::Vec3::sReplicate(1.0f), transform,
+                                                                    settings, JPH::RVec3::sZero(), collector,
+                                                                    filters.broad_phase, filters.layers, filters.body);
+
+            if (out.size() > 1)
+            {
+                std::sort(out.begin(), out.end());
+                out.erase(std::unique(out.begin(), out.end()), out.end());
+            }
+        }
+
+        // shapes of a query only live for its duration, embedded ones skip jolt's reference counting
+        JPH::BoxShape make_box(const vec3_t& half_extents)
+        {
+            JPH::Vec3 extents = to_jolt(half_extents).Abs();
+            return JPH::BoxShape(extents, std::min(JPH::cDefaultConvexRadius, extents.ReduceMin()));
+        }
+    } // namespace
+
+    void raycast(ecs::registry_t& reg, std::span<const ray_t> rays, std::span<hit_t> results)
+    {
+        ZoneScoped;
+        if (!has_results("raycast", rays.size(), results.size())) { return; }
+
+        physics_world_t* physics = get_physics(reg);
+        if (!physics)
+        {
+            std::fill_n(results.begin(), rays.size(), hit_t{});
+            return;
+        }
+
+        run_batch(static_cast<u32_t>(rays.size()),
+                  [&](u32_t i)
+                  {
+                      const ray_t& ray = rays[i];
+                      hit_t& out = results[i];
+                      out = {};
+
+                      JPH::RRayCast cast{to_jolt(ray.origin), to_sweep(ray.direction, ray.max_distance)};
+                      if (cast.mDirection.IsNearZero()) { return; }
+
+                      filters_t filters(physics->config, ray.layer_mask, ray.ignore);
+                      JPH::RayCastResult hit;
+                      if (!physics->system.GetNarrowPhaseQueryNoLock().CastRay(cast, hit, filters.broad_phase,
+                                                                               filters.layers, filters.body))
+                      {
+                          return;
+                      }
+
+                      JPH::BodyLockRead lock(physics->system.GetBodyLockInterfaceNoLock(), hit.mBodyID);
+                      if (!lock.Succeeded()) { return; }
+
+                      const JPH::Body& body = lock.GetBody();
+                      JPH::Vec3 point = cast.GetPointOnRay(hit.mFraction);
+                      out.entity = entity_of(body);
+                      out.distance = hit.mFraction * cast.mDirection.Length();
+                      out.point = from_jolt(point);
+                      out.normal = from_jolt(body.GetWorldSpaceSurfaceNormal(hit.mSubShapeID2, point));
+                  });
+    }
+
+    void sphere_cast(ecs::registry_t& reg, std::span<const sphere_cast_t> casts, std::span<hit_t> results)
+    {
+        ZoneScoped;
+        if (!has_results("sphere_cast", casts.size(), results.size())) { return; }
+
+        physics_world_t* physics = get_physics(reg);
+        if (!physics)
+        {
+            std::fill_n(results.begin(), casts.size(), hit_t{});
+            return;
+        }
+
+        run_batch(static_cast<u32_t>(casts.size()),
+                  [&](u32_t i)
+                  {
+                      const sphere_cast_t& cast = casts[i];
+                      JPH::SphereShape sphere(sphere_radius(cast.radius));
+                      sphere.SetEmbedded();
+
+                      filters_t filters(physics->config, cast.layer_mask, cast.ignore);
+                      cast_shape(*physics, sphere, cast.origin, {0.0f, 0.0f, 0.0f, 1.0f},
+                                 to_sweep(cast.direction, cast.max_distance), filters, results[i]);
+                  });
+    }
+
+    void box_cast(ecs::registry_t& reg, std::span<const box_cast_t> casts, std::span<hit_t> results)
+    {
+        ZoneScoped;
+        if (!has_results("box_cast", casts.size(), results.size())) { return; }
+
+        physics_world_t* physics = get_physics(reg);
+        if (!physics)
+        {
+            std::fill_n(results.begin(), casts.size(), hit_t{});
+            return;
+        }
+
+        run_batch(static_cast<u32_t>(casts.size()),
+                  [&](u32_t i)
+                  {
+                      const box_cast_t& cast = casts[i];
+                      JPH::BoxShape box = make_box(cast.half_extents);
+                      box.SetEmbedded();
+
+                      filters_t filters(physics->config, cast.layer_mask, cast.ignore);
+                      cast_shape(*physics, box, cast.origin, cast.rotation,
+                                 to_sweep(cast.direction, cast.max_distance), filters, results[i]);
+                  });
+    }
+
+    void overlap_spheres(ecs::registry_t& reg, std::span<const sphere_overlap_t> overlaps,
+                         std::span<std::vector<ecs::entity_t>> results)
+    {
+        ZoneScoped;
+        if (!has_results("overlap_spheres", overlaps.size(), results.size())) { return; }
+
+        physics_world_t* physics = get_physics(reg);
+        if (!physics)
+        {
+            for (size_t i = 0; i < overlaps.size(); i++) { results[i].clear(); }
+            return;
+        }
+
+        run_batch(static_cast<u32_t>(overlaps.size()),
+                  [&](u32_t i)
+                  {
+                      const sphere_overlap_t& overlap = overlaps[i];
+                      JPH::SphereShape sphere(sphere_radius(overlap.radius));
+                      sphere.SetEmbedded();
+
+                      filters_t filters(physics->config, overlap.layer_mask, overlap.ignore);
+                      collide_shape(*physics, sphere, overlap.center, {0.0f, 0.0f, 0.0f, 1.0f}, filters,
+                                    results[i]);
+                  });
+    }
+
+    void overlap_boxes(ecs::registry_t& reg, std::span<const box_overlap_t> overlaps,
+                       std::span<std::vector<ecs::entity_t>> results)
+    {
+        ZoneScoped;
+        if (!has_results("overlap_boxes", overlaps.size(), results.size())) { return; }
+
+        physics_world_t* physics = get_physics(reg);
+        if (!physics)
+        {
+            for (size_t i = 0; i < overlaps.size(); i++) { results[i].clear(); }
+            return;
+        }
+
+        run_batch(static_cast<u32_t>(overlaps.size()),
+                  [&](u32_t i)
+                  {
+                      const box_overlap_t& overlap = overlaps[i];
+                      JPH::BoxShape box = make_box(overlap.half_extents);
+                      box.SetEmbedded();
+
+                      filters_t filters(physics->config, overlap.layer_mask, overlap.ignore);
+                      collide_shape(*physics, box, overlap.center, overlap.rotation, filters, results[i]);
+                  });
+    }
+} // namespace smol::physics::query
\ No newline at end of file
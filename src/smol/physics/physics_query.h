@@ -0,0 +1,83 @@
+#pragma once
+
+#include "smol/defines.h"
+#include "smol/ecs_fwd.h"
+#include "smol/math.h"
+
+#include <span>
+#include <vector>
+
+namespace smol::physics::query
+{
+    // every query takes a mask of physics_config_t::layers to test against and can skip one entity, usually the
+    // one asking. direction does not have to be normalized
+    struct SMOL_ENGINE_API ray_t
+    {
+        vec3_t origin;
+        vec3_t direction;
+        f32 max_distance = 1000.0f;
+        u32_t layer_mask = ~0u;
+        ecs::entity_t ignore = ecs::NULL_ENTITY;
+    };
+
+    struct SMOL_ENGINE_API sphere_cast_t
+    {
+        vec3_t origin;
+        f32 radius = 0.5f;
+        vec3_t direction;
+        f32 max_distance = 1000.0f;
+        u32_t layer_mask = ~0u;
+        ecs::entity_t ignore = ecs::NULL_ENTITY;
+    };
+
+    struct SMOL_ENGINE_API box_cast_t
+    {
+        vec3_t origin;
+        quat_t rotation = {0.0f, 0.0f, 0.0f, 1.0f};
+        vec3_t half_extents = {0.5f, 0.5f, 0.5f};
+        vec3_t direction;
+        f32 max_distance = 1000.0f;
+        u32_t layer_mask = ~0u;
+        ecs::entity_t ignore = ecs::NULL_ENTITY;
+    };
+
+    struct SMOL_ENGINE_API sphere_overlap_t
+    {
+        vec3_t center;
+        f32 radius = 0.5f;
+        u32_t layer_mask = ~0u;
+        ecs::entity_t ignore = ecs::NULL_ENTITY;
+    };
+
+    struct SMOL_ENGINE_API box_overlap_t
+    {
+        vec3_t center;
+        quat_t rotation = {0.0f, 0.0f, 0.0f, 1.0f};
+        vec3_t half_extents = {0.5f, 0.5f, 0.5f};
+        u32_t layer_mask = ~0u;
+        ecs::entity_t ignore = ecs::NULL_ENTITY;
+    };
+
+    // closest hit along the query, entity is NULL_ENTITY on a miss. casts that start inside a body hit it at
+    // distance 0
+    struct SMOL_ENGINE_API hit_t
+    {
+        ecs::entity_t entity = ecs::NULL_ENTITY;
+        f32 distance = 0.0f;
+        vec3_t point;
+        vec3_t normal; // points away from the hit body
+    };
+
+    // batch queries against the bodies of the registry's physics world, split into jobs and waited on.
+    // results has to be at least as long as the query span, shorter ones are logged and nothing is run. overlap
+    // vectors are cleared before being filled, spheres with a radius of 0 test a point.
+    // bodies are read without jolt's locks, do not run them while the world steps or creates bodies
+    SMOL_ENGINE_API void raycast(ecs::registry_t& reg, std::span<const ray_t> rays, std::span<hit_t> results);
+    SMOL_ENGINE_API void sphere_cast(ecs::registry_t& reg, std::span<const sphere_cast_t> casts,
+                                     std::span<hit_t> results);
+    SMOL_ENGINE_API void box_cast(ecs::registry_t& reg, std::span<const box_cast_t> casts, std::span<hit_t> results);
+    SMOL_ENGINE_API void overlap_spheres(ecs::registry_t& reg, std::span<const sphere_overlap_t> overlaps,
+                                         std::span<std::vector<ecs::entity_t>> results);
+    SMOL_ENGINE_API void overlap_boxes(ecs::registry_t& reg, std::span<const box_overlap_t> overlaps,
+                                       std::span<std::vector<ecs::entity_t>> results);
+} // namespace smol::physics::query
\ No newline at end of file
@@ -11,52 +11,218 @@
 #include "smol/components/physics.h"
 #include "smol/components/transform.h"
 #include "smol/ecs_fwd.h"
+#include "smol/jobs.h"
 #include "smol/math.h"
 #include "smol/physics/physics_world.h"
+#include "smol/systems/spatial.h"
+#include "smol/systems/transform.h"
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace smol::physics
 {
+    // how far the frame is between the last two physics steps, set by the engine after stepping
+    extern f32 interpolation_alpha;
+
+    // bodies per sync job, each one is a couple of lookups and a pose copy
+    inline constexpr u32_t SYNC_BATCH = 256;
+
+    // kinematic bodies follow their transform. every entity owns its own body, so jobs never touch the same
+    // one and the no-lock interface is enough
     inline void sync_to_physics(ecs::registry_t& reg, physics_world_t& physics_world)
     {
-        JPH::BodyInterface& body_interface = physics_world.system.GetBodyInterface();
+        JPH::BodyInterface& body_interface = physics_world.system.GetBodyInterfaceNoLock();
 
-        for (auto [entity, rb, transform] : reg.view<rigidbody_t, transform_t>().each())
-        {
-            if (rb.type == body_type_e::KINEMATIC)
+        auto& rigidbodies = reg.storage<rigidbody_t>();
+        auto& transforms = reg.storage<transform_t>();
+        const ecs::entity_t* entities = rigidbodies.data();
+
+        jobs::counter_t counter;
+        jobs::dispatch(
+            static_cast<u32_t>(rigidbodies.size()), SYNC_BATCH,
+            [&](u32_t start, u32_t end)
             {
-                JPH::Vec3 pos = {transform.local_position.x, transform.local_position.y, transform.local_position.z};
-                JPH::Quat rot = {transform.local_rotation.x, transform.local_rotation.y, transform.local_rotation.z,
-                                 transform.local_rotation.w};
+                for (u32_t i = start; i < end; i++)
+                {
+                    ecs::entity_t entity = entities[i];
+                    rigidbody_t& rb = rigidbodies.get(entity);
+                    if (rb.type != body_type_e::KINEMATIC || rb.body_id.IsInvalid() || !transforms.contains(entity))
+                    { continue; }
 
-                body_interface.SetPositionAndRotation(rb.body_id, pos, rot, JPH::EActivation::Activate);
-            }
-        }
+                    // cur_* is free for kinematic bodies, it remembers the last pose pushed so a resting
+                    // body does not churn the broadphase every step
+                    const transform_t& transform = transforms.get(entity);
+                    if (glm_vec3_eqv(transform.local_position, rb.cur_position) &&
+                        glm_vec4_eqv(transform.local_rotation, rb.cur_rotation))
+                    {
+                        continue;
+                    }
+                    rb.cur_position = transform.local_position;
+                    rb.cur_rotation = transform.local_rotation;
+
+                    JPH::Vec3 pos = {transform.local_position.x, transform.local_position.y,
+                                     transform.local_position.z};
+                    JPH::Quat rot = {transform.local_rotation.x, transform.local_rotation.y,
+                                     transform.local_rotation.z, transform.local_rotation.w};
+
+                    body_interface.SetPositionAndRotation(rb.body_id, pos, rot, JPH::EActivation::Activate);
+                }
+            },
+            &counter);
+        jobs::wait(&counter);
     }
 
+    // only bodies jolt still has awake, plus the ones that fell asleep during the step, are read. bodies map
+    // back to their entity through the user data create_bodies stores
     inline void sync_from_physics(ecs::registry_t& reg, physics_world_t& physics_world)
     {
-        JPH::BodyInterface& body_interface = physics_world.system.GetBodyInterface();
+        const JPH::BodyInterface& body_interface = physics_world.system.GetBodyInterfaceNoLock();
+
+        auto& rigidbodies = reg.storage<rigidbody_t>();
+        auto& transforms = reg.storage<transform_t>();
+
+        // last step's movers are settled unless they move again below, one more blend lands them on cur
+        std::vector<ecs::entity_t>& moving = physics_world.moving_bodies;
+        std::swap(moving, physics_world.settling_bodies);
+        for (ecs::entity_t entity : physics_world.settling_bodies)
+        {
+            if (!rigidbodies.contains(entity)) { continue; }
+
+            rigidbody_t& rb = rigidbodies.get(entity);
+            rb.prev_position = rb.cur_position;
+            rb.prev_rotation = rb.cur_rotation;
+        }
 
-        for (auto [entity, rb, transform] : reg.view<rigidbody_t, transform_t>().each())
+        JPH::BodyIDVector& bodies = physics_world.synced_bodies;
+        physics_world.system.GetActiveBodies(JPH::EBodyType::RigidBody, bodies);
         {
-            if (rb.type != body_type_e::KINEMATIC)
+            std::lock_guard lock(physics_world.deactivated_mutex);
+            bodies.insert(bodies.end(), physics_world.deactivated_bodies.begin(),
+                          physics_world.deactivated_bodies.end());
+            physics_world.deactivated_bodies.clear();
+        }
+
+        // every job appends the entities that moved, marking them dirty happens below on this thread
+        moving.resize(bodies.size());
+        std::atomic<u32_t> moving_count = 0;
+
+        jobs::counter_t counter;
+        jobs::dispatch(
+            static_cast<u32_t>(bodies.size()), SYNC_BATCH,
+            [&](u32_t start, u32_t end)
             {
-                JPH::Vec3 pos;
-                JPH::Quat rot;
+                for (u32_t i = start; i < end; i++)
+                {
+                    const JPH::BodyID& body_id = bodies[i];
+
+                    // removed bodies and recycled entities both fail the id check
+                    auto entity = static_cast<ecs::entity_t>(static_cast<u32_t>(body_interface.GetUserData(body_id)));
+                    if (!rigidbodies.contains(entity) || !transforms.contains(entity)) { continue; }
+
+                    rigidbody_t& rb = rigidbodies.get(entity);
+                    if (rb.body_id != body_id || rb.type == body_type_e::KINEMATIC) { continue; }
+
+                    JPH::Vec3 pos;
+                    JPH::Quat rot;
+                    body_interface.GetPositionAndRotation(body_id, pos, rot);
+
+                    vec3_t new_position = {pos.GetX(), pos.GetY(), pos.GetZ()};
+                    quat_t new_rotation = {rot.GetX(), rot.GetY(), rot.GetZ(), rot.GetW()};
+
+                    rb.prev_position = rb.cur_position;
+                    rb.prev_rotation = rb.cur_rotation;
+                    if (glm_vec3_eqv(new_position, rb.cur_position) && glm_vec4_eqv(new_rotation, rb.cur_rotation))
+                    { continue; }
 
-                body_interface.GetPositionAndRotation(rb.body_id, pos, rot);
+                    rb.cur_position = new_position;
+                    rb.cur_rotation = new_rotation;
 
-                transform.local_position.x = pos.GetX();
-                transform.local_position.y = pos.GetY();
-                transform.local_position.z = pos.GetZ();
+                    // the real pose for the rest of this step, interpolate_poses blends it for rendering and
+                    // restore_poses puts it back before the next step
+                    transform_t& transform = transforms.get(entity);
+                    transform.local_position = rb.cur_position;
+                    transform.local_rotation = rb.cur_rotation;
 
-                transform.local_rotation.x = rot.GetX();
-                transform.local_rotation.y = rot.GetY();
-                transform.local_rotation.z = rot.GetZ();
-                transform.local_rotation.w = rot.GetW();
+                    moving[moving_count.fetch_add(1, std::memory_order_relaxed)] = entity;
+                }
+            },
+            &counter);
+        jobs::wait(&counter);
 
-                transform.is_dirty = true;
+        moving.resize(moving_count.load(std::memory_order_relaxed));
+        transform_system::mark_dirty(reg, moving);
+    }
+
+    // moves physics driven transforms to where they are interpolation_alpha of the way between the last two
+    // steps, so rendering stays smooth no matter how the fixed rate and the frame rate line up
+    inline void interpolate_poses(ecs::registry_t& reg)
+    {
+        physics_world_t** physics_world = reg.ctx().find<physics_world_t*>();
+        if (!physics_world) { return; }
+
+        f32 alpha = interpolation_alpha;
+
+        auto blend = [&reg, alpha](ecs::entity_t entity)
+        {
+            rigidbody_t* rb = reg.valid(entity) ? reg.try_get<rigidbody_t>(entity) : nullptr;
+            transform_t* transform = rb ? reg.try_get<transform_t>(entity) : nullptr;
+            if (!transform || rb->type == body_type_e::KINEMATIC || !rb->is_initiaklized) { return; }
+
+            vec3_t pos;
+            quat_t rot;
+            glm_vec3_lerp(rb->prev_position, rb->cur_position, alpha, pos);
+            // steps are short, nlerp is close enough to slerp and a lot cheaper
+            glm_quat_nlerp(rb->prev_rotation, rb->cur_rotation, alpha, rot);
+
+            // settled bodies end up here once more after they land, keep them out of the dirty set after that
+            if (glm_vec3_eqv(pos, transform->local_position) && glm_vec4_eqv(rot, transform->local_rotation))
+            { return; }
+
+            transform->local_position = pos;
+            transform->local_rotation = rot;
+            transform_system::mark_dirty(reg, entity);
+        };
+
+        for (ecs::entity_t entity : (*physics_world)->moving_bodies) { blend(entity); }
+        for (ecs::entity_t entity : (*physics_world)->settling_bodies) { blend(entity); }
+        (*physics_world)->are_poses_blended = true;
+    }
+
+    // undoes interpolate_poses. fixed update systems and the physics sync have to work on the last step's pose,
+    // not on one lagging up to a step behind, so world matrices and the spatial index follow as well
+    inline void restore_poses(ecs::registry_t& reg, physics_world_t& physics_world)
+    {
+        if (!physics_world.are_poses_blended) { return; }
+        physics_world.are_poses_blended = false;
+
+        bool is_restored = false;
+        auto restore = [&reg, &is_restored](ecs::entity_t entity)
+        {
+            rigidbody_t* rb = reg.valid(entity) ? reg.try_get<rigidbody_t>(entity) : nullptr;
+            transform_t* transform = rb ? reg.try_get<transform_t>(entity) : nullptr;
+            if (!transform || rb->type == body_type_e::KINEMATIC || !rb->is_initiaklized) { return; }
+
+            if (glm_vec3_eqv(rb->cur_position, transform->local_position) &&
+                glm_vec4_eqv(rb->cur_rotation, transform->local_rotation))
+            {
+                return;
             }
-        }
+
+            transform->local_position = rb->cur_position;
+            transform->local_rotation = rb->cur_rotation;
+            transform_system::mark_dirty(reg, entity);
+            is_restored = true;
+        };
+
+        for (ecs::entity_t entity : physics_world.moving_bodies) { restore(entity); }
+        for (ecs::entity_t entity : physics_world.settling_bodies) { restore(entity); }
+
+        if (!is_restored) { return; }
+
+        transform_system::update(reg);
+        spatial_system::update(reg);
     }
 } // namespace smol::physics
\ No newline at end of file
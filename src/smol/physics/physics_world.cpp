@@ -7,6 +7,7 @@
 #include "Jolt/Core/TempAllocator.h"
 #include "Jolt/Math/Quat.h"
 #include "Jolt/Math/Vec3.h"
+#include "Jolt/Physics/Body/BodyActivationListener.h"
 #include "Jolt/Physics/Body/BodyCreationSettings.h"
 #include "Jolt/Physics/Body/BodyID.h"
 #include "Jolt/Physics/Body/BodyInterface.h"
@@ -15,47 +16,225 @@
 #include "Jolt/Physics/Collision/Shape/Shape.h"
 #include "Jolt/Physics/Collision/Shape/SphereShape.h"
 #include "Jolt/Physics/EActivation.h"
+#include "Jolt/Physics/EPhysicsUpdateError.h"
 #include "Jolt/RegisterTypes.h"
 #include "smol/components/physics.h"
 #include "smol/components/transform.h"
 #include "smol/ecs_fwd.h"
+#include "smol/hash.h"
 #include "smol/log.h"
 #include "smol/physics/jolt_job_system_int.h"
+#include "smol/physics/physics_sync.h"
+#include "smol/systems/transform.h"
 #include "smol/time.h"
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
+#include <mutex>
+#include <string_view>
 #include <vector>
 
 namespace smol
 {
+    namespace physics
+    {
+        f32 interpolation_alpha = 1.0f;
+
+        size_t shape_key_hash_t::operator()(const shape_key_t& key) const
+        { return hash_string64(std::string_view(reinterpret_cast<const char*>(&key), sizeof(key))); }
+
+        namespace
+        {
+            physics_config_t current_config;
+
+            bool is_layer_setup_valid(const physics_config_t& config)
+            {
+                if (config.broad_phase_layers.empty() || config.broad_phase_layers.size() > MAX_LAYERS)
+                {
+                    SMOL_LOG_ERROR("PHYSICS", "Need 1 to {} broadphase layers, got {}", MAX_LAYERS,
+                                   config.broad_phase_layers.size());
+                    return false;
+                }
+
+                if (config.layers.empty() || config.layers.size() > MAX_LAYERS)
+                {
+                    SMOL_LOG_ERROR("PHYSICS", "Need 1 to {} layers, got {}", MAX_LAYERS, config.layers.size());
+                    return false;
+                }
+
+                for (const object_layer_config_t& layer : config.layers)
+                {
+                    if (layer.broad_phase >= config.broad_phase_layers.size())
+                    {
+                        SMOL_LOG_ERROR("PHYSICS", "Layer '{}' uses broadphase layer {} which does not exist",
+                                       layer.name, layer.broad_phase);
+                        return false;
+                    }
+                }
+
+                if (config.static_layer >= config.layers.size() || config.dynamic_layer >= config.layers.size())
+                {
+                    SMOL_LOG_ERROR("PHYSICS", "Static layer {} or dynamic layer {} does not exist",
+                                   config.static_layer, config.dynamic_layer);
+                    return false;
+                }
+
+                return true;
+            }
+        } // namespace
+
+        void configure(const physics_config_t& config)
+        {
+            physics_config_t c = config;
+
+            if (!is_layer_setup_valid(c))
+            {
+                SMOL_LOG_ERROR("PHYSICS", "Falling back to the default layers");
+                physics_config_t defaults;
+                c.broad_phase_layers = defaults.broad_phase_layers;
+                c.layers = defaults.layers;
+                c.static_layer = defaults.static_layer;
+                c.dynamic_layer = defaults.dynamic_layer;
+            }
+
+            // jolt asks both layers of a pair, a one sided entry would make the answer depend on the order
+            u32_t all_layers = c.layers.size() == MAX_LAYERS ? ~0u : (1u << c.layers.size()) - 1;
+            for (object_layer_config_t& layer : c.layers) { layer.collides_with &= all_layers; }
+            for (u32_t a = 0; a < c.layers.size(); a++)
+            {
+                for (u32_t b = 0; b < c.layers.size(); b++)
+                {
+                    if (c.layers[a].collides_with & (1u << b)) { c.layers[b].collides_with |= 1u << a; }
+                }
+            }
+
+            c.max_bodies = std::clamp<u32_t>(c.max_bodies, 1, JPH::BodyID::cMaxBodyIndex + 1);
+            c.collision_steps = std::max<u32_t>(c.collision_steps, 1);
+
+            current_config = std::move(c);
+        }
+
+        const physics_config_t& get_config() { return current_config; }
+
+        u32_t find_layer(std::string_view name)
+        {
+            for (u32_t i = 0; i < current_config.layers.size(); i++)
+            {
+                if (current_config.layers[i].name == name) { return i; }
+            }
+            return AUTO_LAYER;
+        }
+    } // namespace physics
+
     class bp_layer_interface_impl_t final : public JPH::BroadPhaseLayerInterface
     {
       public:
-        virtual JPH::uint GetNumBroadPhaseLayers() const override { return 2; }
+        explicit bp_layer_interface_impl_t(const physics::physics_config_t& config) : config(config) {}
+
+        virtual JPH::uint GetNumBroadPhaseLayers() const override
+        { return static_cast<JPH::uint>(config.broad_phase_layers.size()); }
         virtual JPH::BroadPhaseLayer GetBroadPhaseLayer(JPH::ObjectLayer inLayer) const override
-        { return (inLayer == physics::layers::NON_MOVING) ? JPH::BroadPhaseLayer(0) : JPH::BroadPhaseLayer(1); }
+        { return JPH::BroadPhaseLayer(static_cast<JPH::BroadPhaseLayer::Type>(config.layers[inLayer].broad_phase)); }
 #if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
         virtual const char* GetBroadPhaseLayerName(JPH::BroadPhaseLayer inLayer) const override
-        { return (inLayer.GetValue() == 0) ? "NON_MOVING" : "MOVING"; }
+        { return config.broad_phase_layers[inLayer.GetValue()].c_str(); }
 #endif
+
+      private:
+        const physics::physics_config_t& config;
     };
 
     class object_vs_broad_phase_layer_filter_impl_t : public JPH::ObjectVsBroadPhaseLayerFilter
     {
       public:
-        virtual bool ShouldCollide(JPH::ObjectLayer inLayer1, JPH::BroadPhaseLayer inLayer2) const override
+        // a layer has to visit every broadphase layer holding one of the layers it collides with
+        explicit object_vs_broad_phase_layer_filter_impl_t(const physics::physics_config_t& config)
         {
-            if (inLayer1 == physics::layers::NON_MOVING) return inLayer2.GetValue() == 1;
-            return true;
+            for (size_t layer = 0; layer < config.layers.size(); layer++)
+            {
+                for (size_t other = 0; other < config.layers.size(); other++)
+                {
+                    if (config.layers[layer].collides_with & (1u << other))
+                    { broad_phase_masks[layer] |= 1u << config.layers[other].broad_phase; }
+                }
+            }
         }
+
+        virtual bool ShouldCollide(JPH::ObjectLayer inLayer1, JPH::BroadPhaseLayer inLayer2) const override
+        { return broad_phase_masks[inLayer1] & (1u << inLayer2.GetValue()); }
+
+      private:
+        u32_t broad_phase_masks[physics::MAX_LAYERS] = {};
     };
 
     class object_layer_pair_filter_impl_t : public JPH::ObjectLayerPairFilter
     {
       public:
+        explicit object_layer_pair_filter_impl_t(const physics::physics_config_t& config) : config(config) {}
+
         virtual bool ShouldCollide(JPH::ObjectLayer inObject1, JPH::ObjectLayer inObject2) const override
-        { return !(inObject1 == physics::layers::NON_MOVING && inObject2 == physics::layers::NON_MOVING); }
+        { return config.layers[inObject1].collides_with & (1u << inObject2); }
+
+      private:
+        const physics::physics_config_t& config;
+    };
+
+    // jolt's fixed block with a heap fallback, so a too small temp_allocator_size costs speed instead of
+    // aborting. jolt only uses it from one job at a time, nothing here has to be atomic
+    class temp_allocator_impl_t final : public JPH::TempAllocator
+    {
+      public:
+        temp_allocator_impl_t(u32_t size, physics::physics_stats_t& stats) : block(size), stats(stats) {}
+
+        virtual void* Allocate(JPH::uint inSize) override
+        {
+            if (inSize == 0) { return nullptr; }
+
+            used += JPH::AlignUp(inSize, JPH_RVECTOR_ALIGNMENT);
+            stats.peak_temp_bytes = std::max(stats.peak_temp_bytes, used);
+
+            if (block.CanAllocate(inSize)) { return block.Allocate(inSize); }
+
+            stats.temp_heap_allocations++;
+            return heap.Allocate(inSize);
+        }
+
+        virtual void Free(void* inAddress, JPH::uint inSize) override
+        {
+            if (!inAddress) { return; }
+
+            used -= JPH::AlignUp(inSize, JPH_RVECTOR_ALIGNMENT);
+            if (block.OwnsMemory(inAddress)) { block.Free(inAddress, inSize); }
+            else
+            {
+                heap.Free(inAddress, inSize);
+            }
+        }
+
+      private:
+        JPH::TempAllocatorImpl block;
+        JPH::TempAllocatorMalloc heap;
+        size_t used = 0;
+        physics::physics_stats_t& stats;
+    };
+
+    class body_activation_listener_impl_t final : public JPH::BodyActivationListener
+    {
+      public:
+        explicit body_activation_listener_impl_t(physics_world_t& world) : world(world) {}
+
+        virtual void OnBodyActivated(const JPH::BodyID&, JPH::uint64) override {}
+
+        // called from jolt's workers during the step, and on the main thread when a body is removed
+        virtual void OnBodyDeactivated(const JPH::BodyID& in_body_id, JPH::uint64) override
+        {
+            std::lock_guard lock(world.deactivated_mutex);
+            world.deactivated_bodies.push_back(in_body_id);
+        }
+
+      private:
+        physics_world_t& world;
     };
 
     void on_rigidbody_destroyed(ecs::registry_t& reg, ecs::entity_t entity)
@@ -81,70 +260,213 @@ namespace smol
         SMOL_LOG_FATAL("JPH", "{}", buffer);
     }
 
+    namespace
+    {
+        // jolt's allocator, factory and type registry are process wide, shared by every live physics world
+        std::mutex jolt_mutex;
+        u32_t jolt_users = 0;
+
+        void acquire_jolt()
+        {
+            std::lock_guard lock(jolt_mutex);
+            if (jolt_users++ > 0) { return; }
+
+            JPH::RegisterDefaultAllocator();
+            JPH::Trace = jph_trace_impl;
+            JPH::Factory::sInstance = new JPH::Factory;
+            JPH::RegisterTypes();
+        }
+
+        void release_jolt()
+        {
+            std::lock_guard lock(jolt_mutex);
+            if (--jolt_users > 0) { return; }
+
+            JPH::UnregisterTypes();
+            delete JPH::Factory::sInstance;
+            JPH::Factory::sInstance = nullptr;
+        }
+
+        physics::shape_key_t make_shape_key(physics::shape_kind_e kind, f32 a, f32 b = 0.0f, f32 c = 0.0f)
+        {
+            // + 0.0f folds -0 into 0, the key is hashed bytewise
+            return {kind, {a + 0.0f, b + 0.0f, c + 0.0f}};
+        }
+
+        const JPH::Shape* get_shape(physics_world_t& world, ecs::registry_t& reg, ecs::entity_t entity)
+        {
+            physics::shape_key_t key = make_shape_key(physics::shape_kind_e::BOX, 0.5f, 0.5f, 0.5f);
+            if (box_collider_t* col = reg.try_get<box_collider_t>(entity))
+            { key = make_shape_key(physics::shape_kind_e::BOX, col->extents.x, col->extents.y, col->extents.z); }
+            else if (sphere_collider_t* col = reg.try_get<sphere_collider_t>(entity))
+            {
+                key = make_shape_key(physics::shape_kind_e::SPHERE, col->radius);
+            }
+
+            JPH::RefConst<JPH::Shape>& shape = world.shape_cache[key];
+            if (shape == nullptr)
+            {
+                if (key.kind == physics::shape_kind_e::SPHERE) { shape = new JPH::SphereShape(key.params[0]); }
+                else
+                {
+                    shape = new JPH::BoxShape(JPH::Vec3(key.params[0], key.params[1], key.params[2]));
+                }
+            }
+
+            return shape.GetPtr();
+        }
+
+        // unknown layers fall back like AUTO_LAYER, kinematic bodies move so they get the dynamic layer
+        u32_t get_layer(const physics::physics_config_t& config, const rigidbody_t& rb)
+        {
+            if (rb.layer < config.layers.size()) { return rb.layer; }
+            return rb.type == body_type_e::STATIC ? config.static_layer : config.dynamic_layer;
+        }
+    } // namespace
+
     void physics_world_t::init(ecs::registry_t& reg)
     {
-        JPH::RegisterDefaultAllocator();
-        JPH::Trace = jph_trace_impl;
-        JPH::Factory::sInstance = new JPH::Factory;
-        JPH::RegisterTypes();
+        acquire_jolt();
 
-        temp_allocator = new JPH::TempAllocatorImpl(10 * 1024 * 1024);
+        config = physics::get_config();
+        stats = {};
+
+        temp_allocator = new temp_allocator_impl_t(config.temp_allocator_size, stats);
         job_integration = new jolt_job_system_integration_t();
 
-        bp_interface = new bp_layer_interface_impl_t();
-        object_vs_bp_filter = new object_vs_broad_phase_layer_filter_impl_t();
-        object_vs_object_filter = new object_layer_pair_filter_impl_t();
+        bp_interface = new bp_layer_interface_impl_t(config);
+        object_vs_bp_filter = new object_vs_broad_phase_layer_filter_impl_t(config);
+        object_vs_object_filter = new object_layer_pair_filter_impl_t(config);
+
+        system.Init(config.max_bodies, 0, config.max_body_pairs, config.max_contact_constraints, *bp_interface,
+                    *object_vs_bp_filter, *object_vs_object_filter);
 
-        system.Init(1024, 0, 1024, 1024, *bp_interface, *object_vs_bp_filter, *object_vs_object_filter);
+        activation_listener = new body_activation_listener_impl_t(*this);
+        system.SetBodyActivationListener(activation_listener);
         reg.on_destroy<rigidbody_t>().connect<&on_rigidbody_destroyed>();
     }
 
-    void physics_world_t::update() { system.Update(time::fixed_dt, 1, temp_allocator, job_integration); }
+    void physics_world_t::update()
+    {
+        u32_t heap_allocations = stats.temp_heap_allocations;
+        JPH::EPhysicsUpdateError errors = system.Update(time::fixed_dt, static_cast<i32>(config.collision_steps),
+                                                        temp_allocator, job_integration);
+
+        stats.peak_active_bodies =
+            std::max(stats.peak_active_bodies, system.GetNumActiveBodies(JPH::EBodyType::RigidBody));
+
+        // every limit is only reported the first time it is hit, the stats keep counting
+        if (heap_allocations == 0 && stats.temp_heap_allocations > 0)
+        {
+            SMOL_LOG_WARN("PHYSICS", "Step needed {} bytes of temp memory, physics.temp_allocator_size is {}",
+                          stats.peak_temp_bytes, config.temp_allocator_size);
+        }
+
+        if ((errors & JPH::EPhysicsUpdateError::BodyPairCacheFull) != JPH::EPhysicsUpdateError::None &&
+            stats.body_pair_overflows++ == 0)
+        {
+            SMOL_LOG_WARN("PHYSICS", "Body pair cache full, contacts were dropped. physics.max_body_pairs is {}",
+                          config.max_body_pairs);
+        }
+
+        const JPH::EPhysicsUpdateError contacts_full =
+            JPH::EPhysicsUpdateError::ManifoldCacheFull | JPH::EPhysicsUpdateError::ContactConstraintsFull;
+        if ((errors & contacts_full) != JPH::EPhysicsUpdateError::None && stats.contact_overflows++ == 0)
+        {
+            SMOL_LOG_WARN("PHYSICS", "Contacts were dropped, physics.max_contact_constraints is {}",
+                          config.max_contact_constraints);
+        }
+    }
 
     void physics_world_t::shutdown()
     {
-        JPH::UnregisterTypes();
-        delete JPH::Factory::sInstance;
+        // worlds that never went through init don't hold a jolt reference
+        if (!job_integration) { return; }
+
+        SMOL_LOG_INFO("PHYSICS", "Peak usage: {}/{} bodies ({} active), {}/{} bytes of temp memory",
+                      stats.peak_bodies, config.max_bodies, stats.peak_active_bodies, stats.peak_temp_bytes,
+                      config.temp_allocator_size);
+
         delete job_integration;
         delete temp_allocator;
         delete bp_interface;
         delete object_vs_bp_filter;
         delete object_vs_object_filter;
+        system.SetBodyActivationListener(nullptr);
+        delete activation_listener;
+        job_integration = nullptr;
+        temp_allocator = nullptr;
+        bp_interface = nullptr;
+        object_vs_bp_filter = nullptr;
+        object_vs_object_filter = nullptr;
+        activation_listener = nullptr;
+
+        // shapes go back to jolt's allocator, so before the last world lets go of it
+        shape_cache.clear();
+
+        release_jolt();
     }
 
     void physics_world_t::create_bodies(ecs::registry_t& reg)
     {
         JPH::BodyInterface& body_interface = system.GetBodyInterface();
 
+        // bodies are created one by one but enter the broadphase together, one tree build instead of
+        // one locked insertion each
+        std::vector<JPH::BodyID> batch;
+        u32_t failed_count = 0;
+
+        transform_system::world_matrices_t world_mats = transform_system::get_world_matrices(reg);
         for (auto [entity, rb, transform] : reg.view<rigidbody_t, transform_t>().each())
         {
             if (rb.is_initiaklized) { continue; }
 
-            JPH::RefConst<JPH::Shape> shape;
+            const mat4_t& world_mat = world_mats[transform];
+            JPH::BodyCreationSettings settings(
+                get_shape(*this, reg, entity), JPH::Vec3(world_mat[3][0], world_mat[3][1], world_mat[3][2]),
+                JPH::Quat(transform.local_rotation.x, transform.local_rotation.y, transform.local_rotation.z,
+                          transform.local_rotation.w),
+                rb.type == body_type_e::STATIC ? JPH::EMotionType::Static : JPH::EMotionType::Dynamic,
+                static_cast<JPH::ObjectLayer>(get_layer(config, rb)));
+            // sync_from_physics gets from jolt's active list back to the entity through this
+            settings.mUserData = static_cast<JPH::uint64>(entt::to_integral(entity));
 
-            if (box_collider_t* col = reg.try_get<box_collider_t>(entity))
+            // out of bodies, like CreateAndAddBody this leaves the rigidbody with an invalid id
+            JPH::Body* body = body_interface.CreateBody(settings);
+            if (body)
             {
-                shape = new JPH::BoxShape(JPH::Vec3(col->extents.x, col->extents.y, col->extents.z));
-            }
-            else if (sphere_collider_t* col = reg.try_get<sphere_collider_t>(entity))
-            {
-                shape = new JPH::SphereShape(col->radius);
+                rb.body_id = body->GetID();
+                batch.push_back(rb.body_id);
             }
             else
             {
-                shape = new JPH::BoxShape(JPH::Vec3(0.5, 0.5, 0.5f));
+                rb.body_id = JPH::BodyID();
+                failed_count++;
             }
+            rb.is_initiaklized = true;
 
-            JPH::BodyCreationSettings settings(
-                shape, JPH::Vec3(transform.world_mat[3][0], transform.world_mat[3][1], transform.world_mat[3][2]),
-                JPH::Quat(transform.local_rotation.x, transform.local_rotation.y, transform.local_rotation.z,
-                          transform.local_rotation.w),
-                rb.type == body_type_e::STATIC ? JPH::EMotionType::Static : JPH::EMotionType::Dynamic,
-                rb.type == body_type_e::STATIC ? physics::layers::NON_MOVING : physics::layers::MOVING);
+            // no history yet, the first blend has to land exactly on the spawn pose
+            rb.cur_position = {settings.mPosition.GetX(), settings.mPosition.GetY(), settings.mPosition.GetZ()};
+            rb.cur_rotation = {settings.mRotation.GetX(), settings.mRotation.GetY(), settings.mRotation.GetZ(),
+                               settings.mRotation.GetW()};
+            rb.prev_position = rb.cur_position;
+            rb.prev_rotation = rb.cur_rotation;
+        }
 
-            rb.body_id = body_interface.CreateAndAddBody(settings, JPH::EActivation::Activate);
-            rb.is_initiaklized = true;
+        if (failed_count > 0)
+        {
+            stats.failed_bodies += failed_count;
+            SMOL_LOG_ERROR("PHYSICS", "Out of bodies, {} rigidbodies were not created. physics.max_bodies is {}",
+                           failed_count, config.max_bodies);
         }
+
+        if (batch.empty()) { return; }
+
+        i32 count = static_cast<i32>(batch.size());
+        JPH::BodyInterface::AddState state = body_interface.AddBodiesPrepare(batch.data(), count);
+        body_interface.AddBodiesFinalize(batch.data(), count, state, JPH::EActivation::Activate);
+
+        stats.peak_bodies = std::max(stats.peak_bodies, system.GetNumBodies());
     }
 
     void physics_world_t::destroy_bodies(ecs::registry_t& reg)
@@ -8,22 +8,72 @@
 
 #include "Jolt/Physics/Collision/BroadPhase/BroadPhaseLayer.h"
 #include "Jolt/Physics/Collision/ObjectLayer.h"
+#include "Jolt/Physics/Collision/Shape/Shape.h"
 #include "jolt_job_system_int.h"
 #include "smol/ecs_fwd.h"
+#include "smol/physics/physics_config.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace smol
 {
+    // indices of the layers in the default physics_config_t
     namespace physics::layers
     {
         inline constexpr JPH::ObjectLayer NON_MOVING = 0;
         inline constexpr JPH::ObjectLayer MOVING = 1;
-        inline constexpr JPH::ObjectLayer NUM_LAYERS = 2;
     } // namespace physics::layers
 
+    namespace physics
+    {
+        enum class shape_kind_e : u32_t
+        {
+            BOX,
+            SPHERE,
+        };
+
+        // collider parameters, equal keys share one immutable jolt shape
+        struct SMOL_ENGINE_API shape_key_t
+        {
+            shape_kind_e kind = shape_kind_e::BOX;
+            f32 params[3] = {};
+
+            bool operator==(const shape_key_t& other) const = default;
+        };
+
+        struct SMOL_ENGINE_API shape_key_hash_t
+        {
+            size_t operator()(const shape_key_t& key) const;
+        };
+
+        // high water marks since the world was initialized, to size physics_config_t by
+        struct SMOL_ENGINE_API physics_stats_t
+        {
+            u32_t peak_bodies = 0;
+            u32_t peak_active_bodies = 0;
+            u32_t failed_bodies = 0; // rigidbodies left without a body because max_bodies was reached
+
+            // can go past temp_allocator_size, the rest of that step came from the heap
+            size_t peak_temp_bytes = 0;
+            u32_t temp_heap_allocations = 0;
+
+            // steps in which jolt dropped contacts because max_body_pairs or max_contact_constraints was reached
+            u32_t body_pair_overflows = 0;
+            u32_t contact_overflows = 0;
+        };
+    } // namespace physics
+
     struct SMOL_ENGINE_API physics_world_t
     {
         JPH::PhysicsSystem system;
-        JPH::TempAllocatorImpl* temp_allocator = nullptr;
+        JPH::TempAllocator* temp_allocator = nullptr;
+
+        // copy of physics::get_config() taken by init, the layer filters read it while the world lives
+        physics::physics_config_t config;
+        // kept up to date by every step, read it between steps
+        physics::physics_stats_t stats;
 
         jolt_job_system_integration_t* job_integration = nullptr;
 
@@ -31,6 +81,23 @@ namespace smol
         JPH::ObjectVsBroadPhaseLayerFilter* object_vs_bp_filter = nullptr;
         JPH::ObjectLayerPairFilter* object_vs_object_filter = nullptr;
 
+        std::unordered_map<physics::shape_key_t, JPH::RefConst<JPH::Shape>, physics::shape_key_hash_t> shape_cache;
+
+        // bodies that went to sleep since the last sync, their final pose still has to be read once
+        JPH::BodyActivationListener* activation_listener = nullptr;
+        std::mutex deactivated_mutex;
+        JPH::BodyIDVector deactivated_bodies;
+
+        // scratch for sync_from_physics
+        JPH::BodyIDVector synced_bodies;
+
+        // entities whose pose changed in the last step and the ones that stopped in it, the only ones
+        // interpolate_poses has to look at
+        std::vector<ecs::entity_t> moving_bodies;
+        std::vector<ecs::entity_t> settling_bodies;
+        // set by interpolate_poses, the transforms of those entities hold a blended pose until restore_poses
+        bool are_poses_blended = false;
+
         void init(ecs::registry_t& reg);
         void update();
         void shutdown();
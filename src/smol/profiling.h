@@ -11,4 +11,6 @@
     #define TracyMessageL(txt)
     #define TracyAlloc(ptr, size)
     #define TracyFree(ptr)
+    #define TracyPlot(name, val)
+    #define TracyPlotConfig(name, type, step, fill, color)
 #endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "smol/log.h"
 
 #include "json/json.hpp"
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <utility>
@@ -16,6 +17,58 @@ namespace
     constexpr const char* LIB_PREFIX = "lib";
     constexpr const char* LIB_EXT = ".so";
 #endif
+
+    // AUTO_LAYER when the name is unknown, physics::configure() rejects such a setup and says so
+    u32_t find_name(const std::vector<std::string>& names, const std::string& name)
+    {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? smol::physics::AUTO_LAYER : static_cast<u32_t>(it - names.begin());
+    }
+
+    // layers are referenced by name in the file, "collides_with" lists the layers a layer collides with
+    void load_physics_config(const nlohmann::json& physics, smol::physics::physics_config_t& c)
+    {
+        c.max_bodies = physics.value("max_bodies", c.max_bodies);
+        c.max_body_pairs = physics.value("max_body_pairs", c.max_body_pairs);
+        c.max_contact_constraints = physics.value("max_contact_constraints", c.max_contact_constraints);
+        c.temp_allocator_size = physics.value("temp_allocator_size", c.temp_allocator_size);
+        c.collision_steps = physics.value("collision_steps", c.collision_steps);
+
+        if (!physics.contains("layers") || !physics["layers"].is_array()) { return; }
+
+        std::vector<std::string> layer_names;
+        for (const nlohmann::json& layer : physics["layers"])
+        {
+            if (layer.is_object()) { layer_names.push_back(layer.value("name", "")); }
+        }
+        if (layer_names.empty()) { return; }
+
+        c.broad_phase_layers = physics.value("broad_phase_layers", std::vector<std::string>{});
+        c.layers.clear();
+        for (const nlohmann::json& layer : physics["layers"])
+        {
+            if (!layer.is_object()) { continue; }
+
+            smol::physics::object_layer_config_t out;
+            out.name = layer.value("name", "");
+            out.broad_phase = find_name(c.broad_phase_layers, layer.value("broad_phase", ""));
+
+            for (const std::string& other : layer.value("collides_with", std::vector<std::string>{}))
+            {
+                u32_t other_index = find_name(layer_names, other);
+                if (other_index < smol::physics::MAX_LAYERS) { out.collides_with |= 1u << other_index; }
+                else
+                {
+                    SMOL_LOG_WARN("PROJECT", "Layer '{}' collides with unknown layer '{}'", out.name, other);
+                }
+            }
+
+            c.layers.push_back(std::move(out));
+        }
+
+        c.static_layer = find_name(layer_names, physics.value("static_layer", layer_names.front()));
+        c.dynamic_layer = find_name(layer_names, physics.value("dynamic_layer", layer_names.back()));
+    }
 } // namespace
 
 namespace smol
@@ -65,6 +118,22 @@ namespace smol
         p.assets_dir = p.project_dir / assets_dir;
         p.cooked_assets_dir = p.project_dir / cooked_assets_dir;
 
+        if (data.contains("jobs") && data["jobs"].is_object())
+        {
+            const nlohmann::json& jobs = data["jobs"];
+            p.jobs_config.high_workers = jobs.value("high_workers", p.jobs_config.high_workers);
+            p.jobs_config.low_workers = jobs.value("low_workers", p.jobs_config.low_workers);
+            p.jobs_config.high_affinity = jobs.value("high_affinity", p.jobs_config.high_affinity);
+            p.jobs_config.low_affinity = jobs.value("low_affinity", p.jobs_config.low_affinity);
+            p.jobs_config.high_name = jobs.value("high_name", p.jobs_config.high_name);
+            p.jobs_config.low_name = jobs.value("low_name", p.jobs_config.low_name);
+        }
+
+        if (data.contains("physics") && data["physics"].is_object())
+        {
+            load_physics_config(data["physics"], p.physics_config);
+        }
+
         std::string lib_file = std::string(LIB_PREFIX) + p.game_lib_name + LIB_EXT;
         p.lib_path = p.bin_dir / lib_file;
         p.trigger_path = p.lib_path.string() + ".trigger";
@@ -72,4 +141,4 @@ namespace smol
         out = std::move(p);
         return true;
     }
-} // namespace smol
+} // namespace smol
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "defines.h"
+#include "jobs.h"
+#include "physics/physics_config.h"
 
 #include <filesystem>
 #include <string>
@@ -25,6 +27,11 @@ namespace smol
         std::filesystem::path lib_path;
         std::filesystem::path trigger_path;
 
+        // has to reach jobs::configure() before the engine starts
+        jobs::config_t jobs_config;
+        // has to reach physics::configure() before the first world is initialized
+        physics::physics_config_t physics_config;
+
         SMOL_ENGINE_API static bool load(const std::filesystem::path& project_file, project_t& out);
     };
-} // namespace smol
+} // namespace smol
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include "smol/ecs_fwd.h"
 #include "smol/hash.h"
 #include "smol/math.h"
+#include "smol/systems/transform.h"
 
 #include <entt/entt.hpp>
 #include <entt/meta/meta.hpp>
@@ -19,7 +20,7 @@
 namespace smol::reflection
 {
     void mark_transform_dirty(smol::ecs::registry_t& reg, smol::ecs::entity_t entity)
-    { reg.get<transform_t>(entity).is_dirty = true; }
+    { transform_system::mark_dirty(reg, entity); }
 
     vec3_t get_transform_rot_euler(const smol::transform_t& transform)
     { return quat_t::to_euler(transform.local_rotation); }
@@ -145,7 +146,9 @@ namespace smol::reflection
             .data<&smol::rigidbody_t::type>("type"_h)
             .custom<editor_prop_t>("Body Type")
             .data<&smol::rigidbody_t::is_sensor>("is_sensor"_h)
-            .custom<editor_prop_t>("Is Sensor");
+            .custom<editor_prop_t>("Is Sensor")
+            .data<&smol::rigidbody_t::layer>("layer"_h)
+            .custom<editor_prop_t>("Layer");
 
         factory<smol::box_collider_t>{}
             .type("box_collider_t"_h)
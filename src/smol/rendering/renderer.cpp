@@ -12,6 +12,7 @@
 #include "smol/defines.h"
 #include "smol/ecs_fwd.h"
 #include "smol/engine.h"
+#include "smol/events.h"
 #include "smol/hash.h"
 #include "smol/log.h"
 #include "smol/math.h"
@@ -24,6 +25,7 @@
 #include "smol/rendering/samplers.h"
 #include "smol/rendering/vulkan.h"
 #include "smol/systems/camera.h"
+#include "smol/systems/transform.h"
 #include "smol/time.h"
 #include "smol/window.h"
 
@@ -889,12 +891,13 @@ namespace smol::renderer
 
         bool needs_resize = false;
         u32_t new_width, new_height;
-        for (auto [entity, event] : reg.view<window::window_size_changed_event>().each())
-        {
-            needs_resize = true;
-            new_width = event.width;
-            new_height = event.height;
-        }
+        events::for_each<window::window_size_changed_event>(reg,
+                                                            [&](const window::window_size_changed_event& event)
+                                                            {
+                                                                needs_resize = true;
+                                                                new_width = event.width;
+                                                                new_height = event.height;
+                                                            });
 
         if (needs_resize) { resize(new_width, new_height); }
 
@@ -990,7 +993,7 @@ namespace smol::renderer
             if (active_cam != ecs::NULL_ENTITY)
             {
                 camera_t& cam = reg.get<camera_t>(active_cam);
-                transform_t& cam_transform = reg.get<transform_t>(active_cam);
+                const mat4_t& cam_world = transform_system::get_world_matrix(reg, active_cam);
 
                 render_view_t v{};
                 v.name_hash = "PrimaryView"_h;
@@ -998,8 +1001,7 @@ namespace smol::renderer
                 v.view = cam.view;
                 v.projection = cam.projection;
                 v.view_proj = cam.view_proj;
-                v.position = {cam_transform.world_mat[3][0], cam_transform.world_mat[3][1],
-                              cam_transform.world_mat[3][2]};
+                v.position = {cam_world[3][0], cam_world[3][1], cam_world[3][2]};
                 v.color_target_hash = "SceneColor"_h;
                 v.depth_target_hash = "SceneDepth"_h;
                 v.extent = ctx.render_extent;
@@ -1011,12 +1013,16 @@ namespace smol::renderer
         frame_globals.time = time::time;
         frame_globals.shadow_map_id = BINDLESS_NULL_HANDLE;
 
+        transform_system::world_matrices_t world_mats = transform_system::get_world_matrices(reg);
+
         u32_t dir_count = 0;
         for (auto [entity, light, transform] : reg.view<directional_light_t, transform_t>().each())
         {
             if (dir_count >= MAX_DIR_LIGHTS) { break; }
 
-            vec3_t dir = {transform.world_mat[2][0], transform.world_mat[2][1], transform.world_mat[2][2]};
+            const mat4_t& world_mat = world_mats[transform];
+
+            vec3_t dir = {world_mat[2][0], world_mat[2][1], world_mat[2][2]};
             dir = vec3_t::normalize(dir);
 
             gpu_directional_light_t& gpu_light = frame_data.mapped_dir_lights[dir_count];
@@ -1039,11 +1045,13 @@ namespace smol::renderer
         {
             if (point_count >= MAX_LIGHTS) { break; }
 
+            const mat4_t& world_mat = world_mats[transform];
+
             gpu_point_light_t& gpu_light = frame_data.mapped_point_lights[point_count];
 
-            gpu_light.position_radius.data.x = transform.world_mat[3][0];
-            gpu_light.position_radius.data.y = transform.world_mat[3][1];
-            gpu_light.position_radius.data.z = transform.world_mat[3][2];
+            gpu_light.position_radius.data.x = world_mat[3][0];
+            gpu_light.position_radius.data.y = world_mat[3][1];
+            gpu_light.position_radius.data.z = world_mat[3][2];
             gpu_light.position_radius.data.w = light.intensity;
 
             gpu_light.color_intensity.data.x = light.color.x;
@@ -1059,7 +1067,9 @@ namespace smol::renderer
         {
             if (spot_count >= MAX_LIGHTS) { break; }
 
-            vec3_t dir = {transform.world_mat[2][0], transform.world_mat[2][1], transform.world_mat[2][2]};
+            const mat4_t& world_mat = world_mats[transform];
+
+            vec3_t dir = {world_mat[2][0], world_mat[2][1], world_mat[2][2]};
             dir = vec3_t::normalize(dir);
 
             f32 inner_cos = std::cos(glm_rad(light.inner_angle));
@@ -1067,9 +1077,9 @@ namespace smol::renderer
 
             gpu_spot_light_t& gpu_light = frame_data.mapped_spot_lights[spot_count];
 
-            gpu_light.position_range.data.x = transform.world_mat[3][0];
-            gpu_light.position_range.data.y = transform.world_mat[3][1];
-            gpu_light.position_range.data.z = transform.world_mat[3][2];
+            gpu_light.position_range.data.x = world_mat[3][0];
+            gpu_light.position_range.data.y = world_mat[3][1];
+            gpu_light.position_range.data.z = world_mat[3][2];
             gpu_light.position_range.data.w = light.radius;
 
             gpu_light.direction_intensity.data.x = dir.x;
@@ -1145,6 +1155,8 @@ namespace smol::renderer
         {
             if (!renderer.active || !renderer.mesh || !renderer.material.is_valid()) { continue; }
 
+            const mat4_t& world_mat = world_mats[transform];
+
             material_t* mat = smol::engine::get_asset_registry().get<material_t>(renderer.material);
             if (!mat) { continue; }
 
@@ -1167,10 +1179,10 @@ namespace smol::renderer
             }
 
             object_data_t& obj_data = frame_data.mapped_object_data[cur_object_id];
-            std::memcpy(obj_data.model_matrix.data, &transform.world_mat, sizeof(mat4_t));
+            std::memcpy(obj_data.model_matrix.data, &world_mat, sizeof(mat4_t));
 
             mat4_t normal_mat;
-            glm_mat4_inv(transform.world_mat, normal_mat);
+            glm_mat4_inv(world_mat, normal_mat);
             glm_mat4_transpose(normal_mat);
             std::memcpy(obj_data.normal_matrix.data, &normal_mat, sizeof(mat4_t));
 
@@ -1191,19 +1203,16 @@ namespace smol::renderer
 
             vec3_t world_center;
             vec3_t local_c = mesh->local_center;
-            glm_mat4_mulv3(transform.world_mat, local_c, 1.0f, world_center);
+            glm_mat4_mulv3(world_mat, local_c, 1.0f, world_center);
 
             obj_data.bounding_sphere_center.data.x = world_center.x;
             obj_data.bounding_sphere_center.data.y = world_center.y;
             obj_data.bounding_sphere_center.data.z = world_center.z;
             obj_data.bounding_sphere_center.data.w = 0.0f;
 
-            f32 scale_x =
-                glm_vec3_norm((vec3){transform.world_mat[0][0], transform.world_mat[0][1], transform.world_mat[0][2]});
-            f32 scale_y =
-                glm_vec3_norm((vec3){transform.world_mat[1][0], transform.world_mat[1][1], transform.world_mat[1][2]});
-            f32 scale_z =
-                glm_vec3_norm((vec3){transform.world_mat[2][0], transform.world_mat[2][1], transform.world_mat[2][2]});
+            f32 scale_x = glm_vec3_norm((vec3){world_mat[0][0], world_mat[0][1], world_mat[0][2]});
+            f32 scale_y = glm_vec3_norm((vec3){world_mat[1][0], world_mat[1][1], world_mat[1][2]});
+            f32 scale_z = glm_vec3_norm((vec3){world_mat[2][0], world_mat[2][1], world_mat[2][2]});
 
             f32 max_scale = std::max({scale_x, scale_y, scale_z});
             obj_data.bounding_sphere_radius = mesh->local_radius * max_scale;
@@ -2355,8 +2364,8 @@ namespace smol::renderer
         ecs::entity_t cam_e = camera_system::get_active_camera(reg);
         if (cam_e != ecs::NULL_ENTITY)
         {
-            transform_t& t = reg.get<transform_t>(cam_e);
-            out_pos = {t.world_mat[3][0], t.world_mat[3][1], t.world_mat[3][2]};
+            const mat4_t& world_mat = transform_system::get_world_matrix(reg, cam_e);
+            out_pos = {world_mat[3][0], world_mat[3][1], world_mat[3][2]};
             return true;
         }
 
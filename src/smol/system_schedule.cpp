@@ -0,0 +1,179 @@
+#include "system_schedule.h"
+
+#include "smol/log.h"
+#include "smol/profiling.h"
+
+#include <algorithm>
+
+namespace smol
+{
+    namespace
+    {
+        bool touches(const std::vector<component_access_t>& accesses, entt::id_type type)
+        {
+            return std::any_of(accesses.begin(), accesses.end(),
+                               [type](const component_access_t& access) { return access.type == type; });
+        }
+
+        bool conflicts(const system_access_t& a, const system_access_t& b)
+        {
+            if (a.is_exclusive || b.is_exclusive) { return true; }
+
+            for (const component_access_t& write : a.writes)
+            {
+                if (touches(b.reads, write.type) || touches(b.writes, write.type)) { return true; }
+            }
+
+            for (const component_access_t& write : b.writes)
+            {
+                if (touches(a.reads, write.type)) { return true; }
+            }
+
+            return false;
+        }
+
+        // kahn's algorithm, ties go to the lowest id so the result sticks to registration order where it can
+        bool sort_topologically(const std::vector<std::vector<bool>>& edges, std::vector<system_id_t>& out_order)
+        {
+            u32_t count = static_cast<u32_t>(edges.size());
+
+            std::vector<u32_t> in_degree(count, 0);
+            for (u32_t from = 0; from < count; from++)
+            {
+                for (u32_t to = 0; to < count; to++) { in_degree[to] += edges[from][to] ? 1 : 0; }
+            }
+
+            std::vector<bool> is_placed(count, false);
+            out_order.clear();
+
+            while (out_order.size() < count)
+            {
+                u32_t next = count;
+                for (u32_t i = 0; i < count; i++)
+                {
+                    if (!is_placed[i] && in_degree[i] == 0)
+                    {
+                        next = i;
+                        break;
+                    }
+                }
+
+                if (next == count) { return false; }
+
+                is_placed[next] = true;
+                out_order.push_back(next);
+
+                for (u32_t to = 0; to < count; to++) { in_degree[to] -= edges[next][to] ? 1 : 0; }
+            }
+
+            return true;
+        }
+    } // namespace
+
+    system_id_t system_schedule_t::add(system_func_t func, system_access_t access)
+    {
+        systems.push_back({func, std::move(access)});
+        is_dirty = true;
+
+        return static_cast<system_id_t>(systems.size() - 1);
+    }
+
+    void system_schedule_t::add_ordering(system_id_t first, system_id_t then)
+    {
+        if (first >= systems.size() || then >= systems.size() || first == then)
+        {
+            SMOL_LOG_ERROR("SYSTEMS", "Invalid system ordering {} -> {}", first, then);
+            return;
+        }
+
+        orderings.emplace_back(first, then);
+        is_dirty = true;
+    }
+
+    void system_schedule_t::build()
+    {
+        u32_t count = static_cast<u32_t>(systems.size());
+
+        // edges[a][b] means a has to finish before b starts
+        std::vector<std::vector<bool>> edges(count, std::vector<bool>(count, false));
+        for (const auto& [first, then] : orderings) { edges[first][then] = true; }
+
+        auto add_conflict_edges = [&]()
+        {
+            for (u32_t a = 0; a < count; a++)
+            {
+                for (u32_t b = a + 1; b < count; b++)
+                {
+                    if (!edges[b][a] && conflicts(systems[a].access, systems[b].access)) { edges[a][b] = true; }
+                }
+            }
+        };
+
+        add_conflict_edges();
+
+        if (!sort_topologically(edges, order))
+        {
+            SMOL_LOG_ERROR("SYSTEMS", "System orderings form a cycle, falling back to registration order");
+
+            for (std::vector<bool>& row : edges) { std::fill(row.begin(), row.end(), false); }
+            add_conflict_edges();
+            sort_topologically(edges, order);
+        }
+
+        done.reset(new jobs::counter_t[count]);
+
+        dependencies.assign(count, {});
+        for (u32_t from = 0; from < count; from++)
+        {
+            for (u32_t to = 0; to < count; to++)
+            {
+                if (edges[from][to]) { dependencies[to].push_back(&done[from]); }
+            }
+        }
+
+        is_dirty = false;
+    }
+
+    void system_schedule_t::run(ecs::registry_t& registry)
+    {
+        ZoneScoped;
+
+        if (systems.empty()) { return; }
+        if (is_dirty) { build(); }
+
+        for (system_t& system : systems)
+        {
+            for (component_access_t& access : system.access.reads) { access.assure_storage(registry); }
+            for (component_access_t& access : system.access.writes) { access.assure_storage(registry); }
+        }
+
+        u32_t count = static_cast<u32_t>(systems.size());
+
+        // every counter holds an extra ref until its system is queued (or has run, for exclusive ones), that way
+        // continuations can be attached in any order without a dependency looking finished too early
+        for (u32_t i = 0; i < count; i++) { jobs::detail::add_ref(&done[i], 1); }
+
+        ecs::registry_t* reg = &registry;
+        for (system_id_t id : order)
+        {
+            if (systems[id].access.is_exclusive) { continue; }
+
+            system_func_t func = systems[id].func;
+            jobs::kick_after(dependencies[id], [func, reg]() { func(*reg); }, &done[id]);
+            jobs::detail::release_ref(&done[id]);
+        }
+
+        // exclusive systems stay on the calling thread, in order, once everything before them is done
+        for (system_id_t id : order)
+        {
+            if (!systems[id].access.is_exclusive) { continue; }
+
+            for (jobs::counter_t* dependency : dependencies[id]) { jobs::wait(dependency); }
+
+            systems[id].func(registry);
+            jobs::detail::release_ref(&done[id]);
+        }
+
+        for (u32_t i = 0; i < count; i++) { jobs::wait(&done[i]); }
+    }
+} // namespace smol
\ No newline at end of file
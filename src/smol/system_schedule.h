@@ -0,0 +1,109 @@
+#pragma once
+
+#include "smol/defines.h"
+#include "smol/ecs.h"
+#include "smol/jobs.h"
+
+#include <memory>
+#include <vector>
+
+namespace smol
+{
+    using system_func_t = void (*)(ecs::registry_t&);
+    using system_id_t = u32_t;
+
+    // component access a system declares, register_update_system<reads<transform_t>, writes<camera_t>>(fn)
+    template <typename... Components>
+    struct reads
+    {
+    };
+
+    template <typename... Components>
+    struct writes
+    {
+    };
+
+    struct component_access_t
+    {
+        entt::id_type type;
+
+        // storages are created up front, entt adding a pool while systems run in parallel is a data race
+        void (*assure_storage)(ecs::registry_t&);
+    };
+
+    // a system with no declared access is exclusive, it runs on the thread calling run() with nothing else alongside
+    // it. that is the main thread for the active scene but a job worker for worlds added through engine::add_world.
+    // creating or destroying entities, or touching anything outside the registry, needs an exclusive system
+    struct system_access_t
+    {
+        std::vector<component_access_t> reads;
+        std::vector<component_access_t> writes;
+        bool is_exclusive = true;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        component_access_t make_component_access()
+        { return {entt::type_hash<T>::value(), [](ecs::registry_t& reg) { reg.storage<T>(); }}; }
+
+        template <typename Access>
+        struct access_traits_t;
+
+        template <typename... Components>
+        struct access_traits_t<reads<Components...>>
+        {
+            static void append(system_access_t& access)
+            { (access.reads.push_back(make_component_access<Components>()), ...); }
+        };
+
+        template <typename... Components>
+        struct access_traits_t<writes<Components...>>
+        {
+            static void append(system_access_t& access)
+            { (access.writes.push_back(make_component_access<Components>()), ...); }
+        };
+    } // namespace detail
+
+    template <typename... Access>
+    system_access_t make_system_access()
+    {
+        system_access_t access;
+        access.is_exclusive = sizeof...(Access) == 0;
+        (detail::access_traits_t<Access>::append(access), ...);
+
+        return access;
+    }
+
+    // runs a list of systems on the job system. two systems conflict when either writes something the other one
+    // touches, conflicting systems keep their registration order unless add_ordering() says otherwise, everything
+    // else may run at the same time
+    struct SMOL_ENGINE_API system_schedule_t
+    {
+        struct system_t
+        {
+            system_func_t func;
+            system_access_t access;
+        };
+
+        std::vector<system_t> systems;
+
+        // explicit "first before then" pairs, these win over registration order
+        std::vector<std::pair<system_id_t, system_id_t>> orderings;
+
+        system_id_t add(system_func_t func, system_access_t access);
+        void add_ordering(system_id_t first, system_id_t then);
+
+        void run(ecs::registry_t& registry);
+
+      private:
+        void build();
+
+        bool is_dirty = true;
+
+        // topological order and the counters each system waits for, rebuilt whenever systems or orderings change
+        std::vector<system_id_t> order;
+        std::unique_ptr<jobs::counter_t[]> done;
+        std::vector<std::vector<jobs::counter_t*>> dependencies;
+    };
+} // namespace smol
\ No newline at end of file
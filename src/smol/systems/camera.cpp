@@ -8,6 +8,7 @@
 #include "smol/components/transform.h"
 #include "smol/math.h"
 #include "smol/rendering/renderer.h"
+#include "smol/systems/transform.h"
 
 namespace smol::camera_system
 {
@@ -35,6 +36,7 @@ namespace smol::camera_system
 
         f32 cur_aspect = static_cast<f32>(cur_width) / static_cast<f32>(cur_height);
 
+        transform_system::world_matrices_t world_mats = transform_system::get_world_matrices(reg);
         for (auto [entity, cam, transform] : reg.view<camera_t, transform_t>().each())
         {
             if (std::abs(cam.aspect - cur_aspect) > 0.001f)
@@ -43,9 +45,10 @@ namespace smol::camera_system
                 cam.is_dirty = true;
             }
 
-            vec3_t eye = {transform.world_mat[3][0], transform.world_mat[3][1], transform.world_mat[3][2]};
-            vec3_t forward = {transform.world_mat[2][0], transform.world_mat[2][1], transform.world_mat[2][2]};
-            vec3_t up = {transform.world_mat[1][0], transform.world_mat[1][1], transform.world_mat[1][2]};
+            const mat4_t& world_mat = world_mats[transform];
+            vec3_t eye = {world_mat[3][0], world_mat[3][1], world_mat[3][2]};
+            vec3_t forward = {world_mat[2][0], world_mat[2][1], world_mat[2][2]};
+            vec3_t up = {world_mat[1][0], world_mat[1][1], world_mat[1][2]};
 
             build_view_projection(eye, forward, up, cam.fov_deg, cam.aspect, cam.near_plane, cam.far_plane, cam.view,
                                   cam.projection, cam.view_proj);
@@ -10,7 +10,6 @@ namespace smol::event_system
 {
     void clear_frame_events(ecs::registry_t& reg)
     {
-        auto view = reg.view<events::frame_event_tag>();
-        reg.destroy(view.begin(), view.end());
+        if (events::event_queues_t* queues = reg.ctx().find<events::event_queues_t>()) { queues->clear(); }
     }
 } // namespace smol::event_system
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "smol/math.h"
 #include "smol/rendering/renderer.h"
 #include "smol/rendering/renderer_types.h"
+#include "smol/systems/transform.h"
 
 namespace smol::shadow_system
 {
@@ -27,16 +28,12 @@ namespace smol::shadow_system
         if (dir_lights.begin() == dir_lights.end()) { return; }
 
         ecs::entity_t light_entity = dir_lights.front();
-        transform_t& light_transform = reg.get<transform_t>(light_entity);
+        const mat4_t& light_world = transform_system::get_world_matrix(reg, light_entity);
 
         vec3_t dir;
-        glm_vec3_normalize_to(
-            (vec3){light_transform.world_mat[2][0], light_transform.world_mat[2][1], light_transform.world_mat[2][2]},
-            dir);
+        glm_vec3_normalize_to((vec3){light_world[2][0], light_world[2][1], light_world[2][2]}, dir);
         vec3_t up;
-        glm_vec3_normalize_to(
-            (vec3){light_transform.world_mat[1][0], light_transform.world_mat[1][1], light_transform.world_mat[1][2]},
-            up);
+        glm_vec3_normalize_to((vec3){light_world[1][0], light_world[1][1], light_world[1][2]}, up);
 
         vec3_t center = {cam_pos.x, cam_pos.y, cam_pos.z};
         vec3_t eye = {center.x - dir.x * SHADOW_DISTANCE, center.y - dir.y * SHADOW_DISTANCE,
@@ -60,4 +57,4 @@ namespace smol::shadow_system
         renderer::submit_shadow_view("DirShadowView"_h, view, projection, "ShadowMap"_h,
                                      {SHADOW_MAP_DIM, SHADOW_MAP_DIM}, shadow_desc);
     }
-} // namespace smol::shadow_system
+} // namespace smol::shadow_system
\ No newline at end of file
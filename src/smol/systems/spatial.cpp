@@ -0,0 +1,900 @@
+#include "spatial.h"
+
+#include "smol/asset_registry.h"
+#include "smol/assets/mesh.h"
+#include "smol/components/physics.h"
+#include "smol/components/renderer.h"
+#include "smol/components/transform.h"
+#include "smol/containers/flat_map.h"
+#include "smol/ecs.h"
+#include "smol/engine.h"
+#include "smol/jobs.h"
+#include "smol/profiling.h"
+#include "smol/systems/transform.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+namespace smol::spatial_system
+{
+    namespace
+    {
+        constexpr u32_t NULL_NODE = ~0u;
+
+        // leaves are stored this much larger than their bounds so small motion does not touch the tree
+        constexpr f32 FAT_MARGIN = 0.1f;
+        constexpr f32 FAT_MARGIN_SCALE = 0.1f;
+
+        // queries are one tree walk each, refits touch a handful of floats per entity
+        constexpr u32_t QUERY_GRAIN = 1;
+        constexpr u32_t REFIT_GRAIN = 512;
+
+        // reinserting leaves one by one stops paying off once a good share of them escaped in the same
+        // update, past this fraction the tree is rebuilt top down instead
+        constexpr u32_t REBUILD_DIVISOR = 8;
+
+        aabb_t merge(const aabb_t& a, const aabb_t& b)
+        {
+            return {
+                {std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)},
+                {std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)},
+            };
+        }
+
+        // surface area heuristic without the constant factor
+        f32 half_area(const aabb_t& box)
+        {
+            vec3_t d = box.max - box.min;
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+
+        bool contains(const aabb_t& outer, const aabb_t& inner)
+        {
+            return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+                   outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+        }
+
+        bool overlaps(const aabb_t& a, const aabb_t& b)
+        {
+            return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z && a.max.x >= b.min.x &&
+                   a.max.y >= b.min.y && a.max.z >= b.min.z;
+        }
+
+        aabb_t fatten(const aabb_t& box)
+        {
+            vec3_t size = box.max - box.min;
+            f32 margin = FAT_MARGIN + FAT_MARGIN_SCALE * std::max({size.x, size.y, size.z});
+            vec3_t m = {margin, margin, margin};
+            return {box.min - m, box.max + m};
+        }
+
+        // world bounds of a local box, the rotated extents are projected back onto the axes
+        aabb_t transform_box(const f32* mat, const aabb_t& local)
+        {
+            aabb_t world = {{mat[12], mat[13], mat[14]}, {mat[12], mat[13], mat[14]}};
+            for (u32_t col = 0; col < 3; col++)
+            {
+                for (u32_t row = 0; row < 3; row++)
+                {
+                    f32 a = mat[col * 4 + row] * local.min[col];
+                    f32 b = mat[col * 4 + row] * local.max[col];
+                    world.min[row] += std::min(a, b);
+                    world.max[row] += std::max(a, b);
+                }
+            }
+            return world;
+        }
+
+        // dynamic aabb tree, leaves are entities and every inner node has two children.
+        // inserts pick the sibling that grows the tree's surface area least and rotations keep it balanced
+        class aabb_tree_t
+        {
+          public:
+            struct node_t
+            {
+                // fat box for leaves, union of the children otherwise
+                aabb_t box;
+                // exact bounds, leaves only. queries test these so the margin never shows up in results
+                aabb_t bounds;
+                // next free node while on the free list
+                u32_t parent = NULL_NODE;
+                u32_t children[2] = {NULL_NODE, NULL_NODE};
+                // 0 for leaves, -1 while free
+                i32 height = -1;
+                ecs::entity_t entity = ecs::NULL_ENTITY;
+
+                bool is_leaf() const { return height == 0; }
+                const aabb_t& query_box() const { return is_leaf() ? bounds : box; }
+            };
+
+            std::vector<node_t> nodes;
+            u32_t root = NULL_NODE;
+            u32_t leaf_count = 0;
+
+            u32_t insert(ecs::entity_t entity, const aabb_t& box)
+            {
+                u32_t leaf = allocate_node();
+                nodes[leaf].box = fatten(box);
+                nodes[leaf].bounds = box;
+                nodes[leaf].height = 0;
+                nodes[leaf].entity = entity;
+
+                insert_leaf(leaf);
+                leaf_count++;
+                return leaf;
+            }
+
+            void remove(u32_t leaf)
+            {
+                remove_leaf(leaf);
+                free_node(leaf);
+                leaf_count--;
+            }
+
+            // true if the leaf had to be reinserted, bounds that still fit the fat box cost nothing
+            bool move(u32_t leaf, const aabb_t& box, bool is_forced = false)
+            {
+                nodes[leaf].bounds = box;
+                if (!is_forced && contains(nodes[leaf].box, box)) { return false; }
+
+                remove_leaf(leaf);
+                nodes[leaf].box = fatten(box);
+                insert_leaf(leaf);
+                return true;
+            }
+
+            // new bounds without touching the structure, the tree is invalid until rebuild()
+            void set_leaf_bounds(u32_t leaf, const aabb_t& box)
+            {
+                nodes[leaf].bounds = box;
+                nodes[leaf].box = fatten(box);
+            }
+
+            // throws away every inner node and rebuilds from the leaves sorted along a morton curve,
+            // every node splits its range where the codes first differ
+            void rebuild()
+            {
+                aabb_t centers;
+                build_keys.clear();
+                for (u32_t i = 0; i < nodes.size(); i++)
+                {
+                    if (nodes[i].is_leaf())
+                    {
+                        vec3_t c = nodes[i].box.min + nodes[i].box.max;
+                        centers = build_keys.empty() ? aabb_t{c, c} : merge(centers, {c, c});
+                        build_keys.push_back(i);
+                    }
+                    else if (nodes[i].height > 0) { free_node(i); }
+                }
+
+                if (build_keys.empty())
+                {
+                    root = NULL_NODE;
+                    return;
+                }
+
+                vec3_t extent = centers.max - centers.min;
+                for (u64_t& key : build_keys)
+                {
+                    const aabb_t& box = nodes[key].box;
+                    u64_t code = 0;
+                    for (u32_t axis = 0; axis < 3; axis++)
+                    {
+                        f32 t = extent[axis] > 0.0f
+                                    ? (box.min[axis] + box.max[axis] - centers.min[axis]) / extent[axis]
+                                    : 0.0f;
+                        code |= spread_bits(static_cast<u32_t>(t * 1023.0f)) << axis;
+                    }
+                    key |= code << 32;
+                }
+                std::sort(build_keys.begin(), build_keys.end());
+
+                root = build(0, static_cast<u32_t>(build_keys.size()), NULL_NODE);
+            }
+
+          private:
+            u32_t free_list = NULL_NODE;
+
+            // morton code in the high half, leaf index in the low half
+            std::vector<u64_t> build_keys;
+
+            // 10 bits of v spaced out to every third bit
+            static u64_t spread_bits(u32_t v)
+            {
+                u64_t x = v & 0x3ff;
+                x = (x | (x << 16)) & 0x030000ff;
+                x = (x | (x << 8)) & 0x0300f00f;
+                x = (x | (x << 4)) & 0x030c30c3;
+                x = (x | (x << 2)) & 0x09249249;
+                return x;
+            }
+
+            u32_t build(u32_t begin, u32_t end, u32_t parent)
+            {
+                if (end - begin == 1)
+                {
+                    u32_t leaf = static_cast<u32_t>(build_keys[begin]);
+                    nodes[leaf].parent = parent;
+                    return leaf;
+                }
+
+                // split where the highest bit that differs across the range flips, runs of equal codes split in half
+                u64_t first = build_keys[begin] >> 32;
+                u64_t last = build_keys[end - 1] >> 32;
+                u32_t split = begin + (end - begin) / 2;
+                if (first != last)
+                {
+                    u32_t common = static_cast<u32_t>(std::countl_zero(first ^ last));
+                    u32_t lo = begin;
+                    u32_t hi = end - 1;
+                    while (lo + 1 < hi)
+                    {
+                        u32_t mid = (lo + hi) / 2;
+                        u32_t shared = static_cast<u32_t>(std::countl_zero(first ^ (build_keys[mid] >> 32)));
+                        if (shared > common) { lo = mid; }
+                        else
+                        {
+                            hi = mid;
+                        }
+                    }
+                    split = hi;
+                }
+
+                // allocating may grow the node array, so no references across the recursion
+                u32_t index = allocate_node();
+                nodes[index].parent = parent;
+                u32_t left = build(begin, split, index);
+                u32_t right = build(split, end, index);
+
+                node_t& node = nodes[index];
+                node.children[0] = left;
+                node.children[1] = right;
+                node.height = 1 + std::max(nodes[left].height, nodes[right].height);
+                node.box = merge(nodes[left].box, nodes[right].box);
+                return index;
+            }
+
+            u32_t allocate_node()
+            {
+                if (free_list == NULL_NODE)
+                {
+                    nodes.emplace_back();
+                    return static_cast<u32_t>(nodes.size() - 1);
+                }
+
+                u32_t id = free_list;
+                free_list = nodes[id].parent;
+                nodes[id] = node_t{};
+                return id;
+            }
+
+            void free_node(u32_t id)
+            {
+                nodes[id].height = -1;
+                nodes[id].entity = ecs::NULL_ENTITY;
+                nodes[id].parent = free_list;
+                free_list = id;
+            }
+
+            void insert_leaf(u32_t leaf)
+            {
+                if (root == NULL_NODE)
+                {
+                    root = leaf;
+                    nodes[leaf].parent = NULL_NODE;
+                    return;
+                }
+
+                // walk down while descending is cheaper than pairing the leaf with the current node
+                aabb_t leaf_box = nodes[leaf].box;
+                u32_t index = root;
+                while (!nodes[index].is_leaf())
+                {
+                    const node_t& node = nodes[index];
+
+                    f32 area = half_area(node.box);
+                    f32 combined_area = half_area(merge(node.box, leaf_box));
+
+                    f32 cost = 2.0f * combined_area;
+                    f32 inheritance_cost = 2.0f * (combined_area - area);
+
+                    f32 child_cost[2];
+                    for (u32_t c = 0; c < 2; c++)
+                    {
+                        const node_t& child = nodes[node.children[c]];
+                        f32 merged_area = half_area(merge(leaf_box, child.box));
+                        f32 growth = child.is_leaf() ? merged_area : merged_area - half_area(child.box);
+                        child_cost[c] = inheritance_cost + growth;
+                    }
+
+                    if (cost < child_cost[0] && cost < child_cost[1]) { break; }
+                    index = child_cost[0] < child_cost[1] ? node.children[0] : node.children[1];
+                }
+
+                u32_t sibling = index;
+                u32_t old_parent = nodes[sibling].parent;
+                u32_t new_parent = allocate_node();
+
+                nodes[new_parent].parent = old_parent;
+                nodes[new_parent].box = merge(leaf_box, nodes[sibling].box);
+                nodes[new_parent].height = nodes[sibling].height + 1;
+                nodes[new_parent].children[0] = sibling;
+                nodes[new_parent].children[1] = leaf;
+                nodes[sibling].parent = new_parent;
+                nodes[leaf].parent = new_parent;
+
+                if (old_parent == NULL_NODE) { root = new_parent; }
+                else
+                {
+                    replace_child(old_parent, sibling, new_parent);
+                }
+
+                refit_upwards(nodes[leaf].parent);
+            }
+
+            void remove_leaf(u32_t leaf)
+            {
+                if (leaf == root)
+                {
+                    root = NULL_NODE;
+                    return;
+                }
+
+                u32_t parent = nodes[leaf].parent;
+                u32_t grand_parent = nodes[parent].parent;
+                const u32_t* siblings = nodes[parent].children;
+                u32_t sibling = siblings[0] == leaf ? siblings[1] : siblings[0];
+
+                nodes[sibling].parent = grand_parent;
+                free_node(parent);
+
+                if (grand_parent == NULL_NODE) { root = sibling; }
+                else
+                {
+                    replace_child(grand_parent, parent, sibling);
+                    refit_upwards(grand_parent);
+                }
+            }
+
+            void replace_child(u32_t parent, u32_t old_child, u32_t new_child)
+            {
+                node_t& node = nodes[parent];
+                if (node.children[0] == old_child) { node.children[0] = new_child; }
+                else
+                {
+                    node.children[1] = new_child;
+                }
+            }
+
+            void refit_upwards(u32_t index)
+            {
+                while (index != NULL_NODE)
+                {
+                    index = balance(index);
+
+                    node_t& node = nodes[index];
+                    const node_t& a = nodes[node.children[0]];
+                    const node_t& b = nodes[node.children[1]];
+                    node.height = 1 + std::max(a.height, b.height);
+                    node.box = merge(a.box, b.box);
+
+                    index = node.parent;
+                }
+            }
+
+            // if one child is more than a level taller, its taller grandchild takes the node's place.
+            // returns the index that now sits where index used to
+            u32_t balance(u32_t index)
+            {
+                node_t& a = nodes[index];
+                if (a.is_leaf() || a.height < 2) { return index; }
+
+                i32 skew = nodes[a.children[1]].height - nodes[a.children[0]].height;
+                if (skew > 1) { return rotate(index, 1); }
+                if (skew < -1) { return rotate(index, 0); }
+                return index;
+            }
+
+            // lifts child `side` of a above it, a keeps the other child plus the shorter grandchild
+            u32_t rotate(u32_t a_index, u32_t side)
+            {
+                node_t& a = nodes[a_index];
+                u32_t up_index = a.children[side];
+                node_t& up = nodes[up_index];
+                node_t& stay = nodes[a.children[1 - side]];
+
+                u32_t f_index = up.children[0];
+                u32_t g_index = up.children[1];
+                node_t& f = nodes[f_index];
+                node_t& g = nodes[g_index];
+
+                up.children[0] = a_index;
+                up.parent = a.parent;
+                a.parent = up_index;
+
+                if (up.parent == NULL_NODE) { root = up_index; }
+                else
+                {
+                    replace_child(up.parent, a_index, up_index);
+                }
+
+                u32_t taller_index = f.height > g.height ? f_index : g_index;
+                u32_t shorter_index = f.height > g.height ? g_index : f_index;
+                node_t& taller = nodes[taller_index];
+                node_t& shorter = nodes[shorter_index];
+
+                up.children[1] = taller_index;
+                a.children[side] = shorter_index;
+                shorter.parent = a_index;
+
+                a.box = merge(stay.box, shorter.box);
+                a.height = 1 + std::max(stay.height, shorter.height);
+                up.box = merge(a.box, taller.box);
+                up.height = 1 + std::max(a.height, taller.height);
+
+                return up_index;
+            }
+        };
+
+        struct proxy_t
+        {
+            u32_t leaf = NULL_NODE;
+            aabb_t local_bounds;
+            bool is_queued = false;
+        };
+
+        // per world, lives in the registry ctx next to the transform hierarchy
+        struct spatial_index_t
+        {
+            aabb_tree_t tree;
+
+            // keyed by the full entity id so a recycled entity never finds the previous owner's leaf
+            flat_map_t<proxy_t> proxies;
+            std::vector<ecs::entity_t> pending;
+            std::vector<ecs::entity_t> still_pending;
+
+            // leaves whose bounds left their fat box during a refit, reinserted afterwards on one thread
+            std::vector<std::pair<u32_t, aabb_t>> escaped;
+            std::atomic<u32_t> escaped_count = 0;
+        };
+
+        spatial_index_t& get_index(ecs::registry_t& reg)
+        {
+            if (spatial_index_t* index = reg.ctx().find<spatial_index_t>()) { return *index; }
+            return reg.ctx().emplace<spatial_index_t>();
+        }
+
+        u32_t key_of(ecs::entity_t entity) { return static_cast<u32_t>(entt::to_integral(entity)); }
+
+        void queue(spatial_index_t& index, ecs::entity_t entity)
+        {
+            proxy_t& proxy = index.proxies[key_of(entity)];
+            if (proxy.is_queued) { return; }
+
+            proxy.is_queued = true;
+            index.pending.push_back(entity);
+        }
+
+        enum class bounds_state_e : u8_t
+        {
+            NONE,
+            READY,
+            WAITING,
+        };
+
+        // union of the mesh's bounding sphere and the collider, in the entity's local space
+        bounds_state_e compute_local_bounds(ecs::registry_t& reg, ecs::entity_t entity, aabb_t& bounds)
+        {
+            bool has_bounds = false;
+            auto add = [&](const aabb_t& box)
+            {
+                bounds = has_bounds ? merge(bounds, box) : box;
+                has_bounds = true;
+            };
+
+            bool is_waiting = false;
+            if (const mesh_renderer_t* renderer = reg.try_get<mesh_renderer_t>(entity))
+            {
+                // headless scenes keep invalid handles, those are never going to load
+                if (renderer->mesh.is_valid())
+                {
+                    if (const mesh_t* mesh = engine::get_asset_registry().get<mesh_t>(renderer->mesh))
+                    {
+                        vec3_t r = {mesh->local_radius, mesh->local_radius, mesh->local_radius};
+                        add({mesh->local_center - r, mesh->local_center + r});
+                    }
+                    else
+                    {
+                        is_waiting = true;
+                    }
+                }
+            }
+
+            // same fallback create_bodies uses for a body without a collider
+            if (reg.all_of<rigidbody_t>(entity))
+            {
+                if (const box_collider_t* box = reg.try_get<box_collider_t>(entity))
+                { add({box->offset - box->extents, box->offset + box->extents}); }
+                else if (const sphere_collider_t* sphere = reg.try_get<sphere_collider_t>(entity))
+                {
+                    vec3_t r = {sphere->radius, sphere->radius, sphere->radius};
+                    add({-1.0f * r, r});
+                }
+                else
+                {
+                    add({{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}});
+                }
+            }
+
+            if (is_waiting) { return bounds_state_e::WAITING; }
+            return has_bounds ? bounds_state_e::READY : bounds_state_e::NONE;
+        }
+
+        // creates, refreshes or drops the leaf of every queued entity. meshes that are still loading keep
+        // their entity queued, if it has a body the leaf already covers that in the meantime
+        void resolve_pending(ecs::registry_t& reg, spatial_index_t& index)
+        {
+            index.still_pending.clear();
+
+            for (ecs::entity_t entity : index.pending)
+            {
+                proxy_t* proxy = index.proxies.find(key_of(entity));
+                if (!proxy) { continue; }
+
+                const transform_t* transform = reg.valid(entity) ? reg.try_get<transform_t>(entity) : nullptr;
+
+                aabb_t local_bounds;
+                bounds_state_e state =
+                    transform ? compute_local_bounds(reg, entity, local_bounds) : bounds_state_e::NONE;
+
+                bool has_bounds = state == bounds_state_e::READY ||
+                                  (state == bounds_state_e::WAITING && reg.all_of<rigidbody_t>(entity));
+                if (!has_bounds)
+                {
+                    if (proxy->leaf != NULL_NODE) { index.tree.remove(proxy->leaf); }
+
+                    if (state == bounds_state_e::WAITING)
+                    {
+                        proxy->leaf = NULL_NODE;
+                        index.still_pending.push_back(entity);
+                    }
+                    else
+                    {
+                        index.proxies.erase(key_of(entity));
+                    }
+                    continue;
+                }
+
+                proxy->local_bounds = local_bounds;
+                aabb_t world_bounds = transform_box(transform_system::get_world_matrix(reg, *transform), local_bounds);
+                if (proxy->leaf == NULL_NODE) { proxy->leaf = index.tree.insert(entity, world_bounds); }
+                else
+                {
+                    index.tree.move(proxy->leaf, world_bounds, true);
+                }
+
+                if (state == bounds_state_e::WAITING) { index.still_pending.push_back(entity); }
+                else
+                {
+                    proxy->is_queued = false;
+                }
+            }
+
+            std::swap(index.pending, index.still_pending);
+        }
+
+        template <typename Fn>
+        void run_batch(u32_t count, Fn&& fn)
+        {
+            jobs::parallel_for(
+                0, count,
+                [&fn](u32_t start, u32_t end)
+                {
+                    for (u32_t i = start; i < end; i++) { fn(i); }
+                },
+                QUERY_GRAIN);
+        }
+
+        // scratch stack for tree walks, one per worker so queries of a batch can run side by side
+        std::vector<std::pair<u32_t, u32_t>>& get_walk_stack()
+        {
+            thread_local std::vector<std::pair<u32_t, u32_t>> stack;
+            stack.clear();
+            return stack;
+        }
+
+        void collect_leaves(const aabb_tree_t& tree, u32_t index, std::vector<ecs::entity_t>& out,
+                            std::vector<std::pair<u32_t, u32_t>>& stack)
+        {
+            size_t base = stack.size();
+            stack.push_back({index, 0});
+            while (stack.size() > base)
+            {
+                const aabb_tree_t::node_t& node = tree.nodes[stack.back().first];
+                stack.pop_back();
+
+                if (node.is_leaf()) { out.push_back(node.entity); }
+                else
+                {
+                    stack.push_back({node.children[0], 0});
+                    stack.push_back({node.children[1], 0});
+                }
+            }
+        }
+
+        // walks every node overlapping the query, `test` decides per box
+        template <typename Test>
+        void query_overlaps(const aabb_tree_t& tree, std::vector<ecs::entity_t>& out, Test&& test)
+        {
+            out.clear();
+            if (tree.root == NULL_NODE) { return; }
+
+            std::vector<std::pair<u32_t, u32_t>>& stack = get_walk_stack();
+            stack.push_back({tree.root, 0});
+            while (!stack.empty())
+            {
+                const aabb_tree_t::node_t& node = tree.nodes[stack.back().first];
+                stack.pop_back();
+
+                if (!test(node.query_box())) { continue; }
+
+                if (node.is_leaf()) { out.push_back(node.entity); }
+                else
+                {
+                    stack.push_back({node.children[0], 0});
+                    stack.push_back({node.children[1], 0});
+                }
+            }
+        }
+
+        void query_frustum(const aabb_tree_t& tree, const frustum_t& frustum, std::vector<ecs::entity_t>& out)
+        {
+            out.clear();
+            if (tree.root == NULL_NODE) { return; }
+
+            // the second value is a mask of the planes the node might still cross, once it is empty the whole
+            // subtree is inside and gets taken without further tests
+            constexpr u32_t ALL_PLANES = (1u << 6) - 1;
+
+            std::vector<std::pair<u32_t, u32_t>>& stack = get_walk_stack();
+            stack.push_back({tree.root, ALL_PLANES});
+            while (!stack.empty())
+            {
+                auto [index, mask] = stack.back();
+                stack.pop_back();
+                const aabb_tree_t::node_t& node = tree.nodes[index];
+
+                const aabb_t& box = node.query_box();
+                vec3_t center = (box.min + box.max) * 0.5f;
+                vec3_t extents = (box.max - box.min) * 0.5f;
+
+                bool is_outside = false;
+                for (u32_t p = 0; p < 6 && !is_outside; p++)
+                {
+                    if (!(mask & (1u << p))) { continue; }
+
+                    const vec4_t& plane = frustum.planes[p];
+                    f32 distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+                    f32 radius = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y +
+                                 std::abs(plane.z) * extents.z;
+
+                    if (distance < -radius) { is_outside = true; }
+                    else if (distance >= radius) { mask &= ~(1u << p); }
+                }
+
+                if (is_outside) { continue; }
+
+                if (mask == 0) { collect_leaves(tree, index, out, stack); }
+                else if (node.is_leaf()) { out.push_back(node.entity); }
+                else
+                {
+                    stack.push_back({node.children[0], mask});
+                    stack.push_back({node.children[1], mask});
+                }
+            }
+        }
+
+        // slab test, the entry distance or a negative value on a miss
+        f32 ray_box(const aabb_t& box, const vec3_t& origin, const vec3_t& inv_dir, f32 max_distance)
+        {
+            f32 t_min = 0.0f;
+            f32 t_max = max_distance;
+            for (u32_t axis = 0; axis < 3; axis++)
+            {
+                f32 t0 = (box.min[axis] - origin[axis]) * inv_dir[axis];
+                f32 t1 = (box.max[axis] - origin[axis]) * inv_dir[axis];
+                if (t0 > t1) { std::swap(t0, t1); }
+
+                t_min = std::max(t_min, t0);
+                t_max = std::min(t_max, t1);
+                if (t_min > t_max) { return -1.0f; }
+            }
+            return t_min;
+        }
+
+        ray_hit_t query_ray(const aabb_tree_t& tree, const ray_t& ray)
+        {
+            ray_hit_t hit;
+            f32 length = ray.direction.length();
+            if (tree.root == NULL_NODE || length <= 0.0f) { return hit; }
+
+            vec3_t dir = ray.direction / length;
+            vec3_t inv_dir = {1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z};
+            f32 best = ray.max_distance;
+
+            // nearer child goes on top so the best distance shrinks early and prunes the rest
+            std::vector<std::pair<u32_t, u32_t>>& stack = get_walk_stack();
+            stack.push_back({tree.root, 0});
+            while (!stack.empty())
+            {
+                const aabb_tree_t::node_t& node = tree.nodes[stack.back().first];
+                stack.pop_back();
+
+                f32 t = ray_box(node.query_box(), ray.origin, inv_dir, best);
+                if (t < 0.0f) { continue; }
+
+                if (node.is_leaf())
+                {
+                    best = t;
+                    hit = {node.entity, t};
+                    continue;
+                }
+
+                u32_t near = node.children[0];
+                u32_t far = node.children[1];
+                f32 t_near = ray_box(tree.nodes[near].query_box(), ray.origin, inv_dir, best);
+                f32 t_far = ray_box(tree.nodes[far].query_box(), ray.origin, inv_dir, best);
+                if (t_far >= 0.0f && (t_near < 0.0f || t_far < t_near))
+                {
+                    std::swap(near, far);
+                    std::swap(t_near, t_far);
+                }
+
+                if (t_far >= 0.0f) { stack.push_back({far, 0}); }
+                if (t_near >= 0.0f) { stack.push_back({near, 0}); }
+            }
+
+            return hit;
+        }
+    } // namespace
+
+    void query_frustums(ecs::registry_t& reg, std::span<const frustum_t> frustums,
+                        std::span<std::vector<ecs::entity_t>> results)
+    {
+        ZoneScoped;
+        const aabb_tree_t& tree = get_index(reg).tree;
+        run_batch(static_cast<u32_t>(frustums.size()),
+                  [&](u32_t i) { query_frustum(tree, frustums[i], results[i]); });
+    }
+
+    void query_spheres(ecs::registry_t& reg, std::span<const sphere_t> spheres,
+                       std::span<std::vector<ecs::entity_t>> results)
+    {
+        ZoneScoped;
+        const aabb_tree_t& tree = get_index(reg).tree;
+        run_batch(static_cast<u32_t>(spheres.size()),
+                  [&](u32_t i)
+                  {
+                      const sphere_t& sphere = spheres[i];
+                      query_overlaps(tree, results[i],
+                                     [&sphere](const aabb_t& box)
+                                     {
+                                         f32 distance_sq = 0.0f;
+                                         for (u32_t axis = 0; axis < 3; axis++)
+                                         {
+                                             f32 d = sphere.center[axis] -
+                                                     std::clamp(sphere.center[axis], box.min[axis], box.max[axis]);
+                                             distance_sq += d * d;
+                                         }
+                                         return distance_sq <= sphere.radius * sphere.radius;
+                                     });
+                  });
+    }
+
+    void query_boxes(ecs::registry_t& reg, std::span<const aabb_t> boxes,
+                     std::span<std::vector<ecs::entity_t>> results)
+    {
+        ZoneScoped;
+        const aabb_tree_t& tree = get_index(reg).tree;
+        run_batch(static_cast<u32_t>(boxes.size()),
+                  [&](u32_t i)
+                  {
+                      const aabb_t& query = boxes[i];
+                      query_overlaps(tree, results[i], [&query](const aabb_t& box) { return overlaps(query, box); });
+                  });
+    }
+
+    void raycast(ecs::registry_t& reg, std::span<const ray_t> rays, std::span<ray_hit_t> results)
+    {
+        ZoneScoped;
+        const aabb_tree_t& tree = get_index(reg).tree;
+        run_batch(static_cast<u32_t>(rays.size()), [&](u32_t i) { results[i] = query_ray(tree, rays[i]); });
+    }
+
+    void on_source_changed(ecs::registry_t& reg, ecs::entity_t entity)
+    {
+        if (!reg.any_of<mesh_renderer_t, rigidbody_t>(entity)) { return; }
+        queue(get_index(reg), entity);
+    }
+
+    void on_source_destroyed(ecs::registry_t& reg, ecs::entity_t entity)
+    {
+        // the leaf goes right away so queries never hand out a dying entity, the next update puts it back
+        // if the entity still has something to bound
+        spatial_index_t& index = get_index(reg);
+        proxy_t* proxy = index.proxies.find(key_of(entity));
+        if (!proxy) { return; }
+
+        if (proxy->leaf != NULL_NODE)
+        {
+            index.tree.remove(proxy->leaf);
+            proxy->leaf = NULL_NODE;
+        }
+        queue(index, entity);
+    }
+
+    void rebuild(ecs::registry_t& reg)
+    {
+        spatial_index_t& index = get_index(reg);
+        for (ecs::entity_t entity : reg.view<transform_t, mesh_renderer_t>()) { queue(index, entity); }
+        for (ecs::entity_t entity : reg.view<transform_t, rigidbody_t>()) { queue(index, entity); }
+    }
+
+    void update(ecs::registry_t& reg)
+    {
+        ZoneScoped;
+
+        spatial_index_t& index = get_index(reg);
+        resolve_pending(reg, index);
+
+        if (index.proxies.empty()) { return; }
+
+        const std::vector<std::vector<ecs::entity_t>>& levels = transform_system::get_updated_levels(reg);
+
+        size_t moved_count = 0;
+        for (const std::vector<ecs::entity_t>& level : levels) { moved_count += level.size(); }
+        if (index.escaped.size() < moved_count) { index.escaped.resize(moved_count); }
+        index.escaped_count.store(0, std::memory_order_relaxed);
+
+        // the tree is only read here, anything that left its fat box is reinserted below
+        auto view = reg.view<transform_t>();
+        transform_system::world_matrices_t world_mats = transform_system::get_world_matrices(reg);
+        for (const std::vector<ecs::entity_t>& level : levels)
+        {
+            jobs::parallel_for(
+                0, static_cast<u32_t>(level.size()),
+                [&view, &world_mats, &level, &index](u32_t start, u32_t end)
+                {
+                    for (u32_t i = start; i < end; i++)
+                    {
+                        const proxy_t* proxy = index.proxies.find(key_of(level[i]));
+                        if (!proxy || proxy->leaf == NULL_NODE) { continue; }
+
+                        // each leaf belongs to one entity, so writing its exact bounds here races with nothing
+                        aabb_t box = transform_box(world_mats[view.get<transform_t>(level[i])], proxy->local_bounds);
+                        aabb_tree_t::node_t& leaf = index.tree.nodes[proxy->leaf];
+                        leaf.bounds = box;
+                        if (contains(leaf.box, box)) { continue; }
+
+                        u32_t slot = index.escaped_count.fetch_add(1, std::memory_order_relaxed);
+                        index.escaped[slot] = {proxy->leaf, box};
+                    }
+                },
+                REFIT_GRAIN);
+        }
+
+        u32_t escaped_count = index.escaped_count.load(std::memory_order_relaxed);
+        if (escaped_count > index.tree.leaf_count / REBUILD_DIVISOR)
+        {
+            for (u32_t i = 0; i < escaped_count; i++)
+            { index.tree.set_leaf_bounds(index.escaped[i].first, index.escaped[i].second); }
+            index.tree.rebuild();
+            return;
+        }
+
+        for (u32_t i = 0; i < escaped_count; i++) { index.tree.move(index.escaped[i].first, index.escaped[i].second); }
+    }
+} // namespace smol::spatial_system
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "smol/defines.h"
+#include "smol/ecs_fwd.h"
+#include "smol/math.h"
+
+#include <span>
+#include <vector>
+
+namespace smol::spatial_system
+{
+    struct SMOL_ENGINE_API aabb_t
+    {
+        vec3_t min;
+        vec3_t max;
+    };
+
+    struct SMOL_ENGINE_API sphere_t
+    {
+        vec3_t center;
+        f32 radius = 0.0f;
+    };
+
+    // planes as glm_frustum_planes produces them, normals point inwards
+    struct SMOL_ENGINE_API frustum_t
+    {
+        vec4_t planes[6];
+    };
+
+    struct SMOL_ENGINE_API ray_t
+    {
+        vec3_t origin;
+        vec3_t direction;
+        f32 max_distance = 1e30f;
+    };
+
+    // closest bounding box along the ray, entity is NULL_ENTITY on a miss
+    struct SMOL_ENGINE_API ray_hit_t
+    {
+        ecs::entity_t entity = ecs::NULL_ENTITY;
+        f32 distance = 0.0f;
+    };
+
+    // batch queries, every query of a batch runs as its own job and writes only its own result.
+    // results has to be at least as long as the query span, vectors are cleared before being filled.
+    // the index is read only while querying, do not run them alongside update() on the same registry
+    SMOL_ENGINE_API void query_frustums(ecs::registry_t& reg, std::span<const frustum_t> frustums,
+                                        std::span<std::vector<ecs::entity_t>> results);
+    SMOL_ENGINE_API void query_spheres(ecs::registry_t& reg, std::span<const sphere_t> spheres,
+                                       std::span<std::vector<ecs::entity_t>> results);
+    SMOL_ENGINE_API void query_boxes(ecs::registry_t& reg, std::span<const aabb_t> boxes,
+                                     std::span<std::vector<ecs::entity_t>> results);
+    SMOL_ENGINE_API void raycast(ecs::registry_t& reg, std::span<const ray_t> rays, std::span<ray_hit_t> results);
+
+    // hooked to construct/update/destroy of transform_t, mesh_renderer_t and rigidbody_t. entities with a
+    // transform and a mesh or a body get a leaf, the bounds are worked out on the next update
+    void on_source_changed(ecs::registry_t& reg, ecs::entity_t entity);
+    void on_source_destroyed(ecs::registry_t& reg, ecs::entity_t entity);
+
+    // queues everything, only for registries that were filled before the hooks were connected
+    void rebuild(ecs::registry_t& reg);
+
+    // refits the leaves of everything the last transform update moved, call right after it
+    SMOL_ENGINE_API void update(ecs::registry_t& reg);
+} // namespace smol::spatial_system
\ No newline at end of file
@@ -7,71 +7,275 @@
 #include "smol/defines.h"
 #include "smol/ecs.h"
 #include "smol/ecs_fwd.h"
+#include "smol/jobs.h"
 #include "smol/log.h"
 #include "smol/math.h"
+#include "smol/memory/linear_allocator.h"
 #include "smol/profiling.h"
+#include "smol/systems/transform_kernels.h"
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 namespace smol::transform_system
 {
     namespace
     {
-        std::vector<ecs::entity_t> sort_stack;
-        std::vector<ecs::entity_t> sort_res;
-    } // namespace
+        // below this many transforms a level is cheaper to do inline than to split across workers
+        constexpr u32_t LEVEL_GRAIN = 256;
+        constexpr u32_t INVALID_LEVEL_INDEX = ~0u;
+
+        constexpr f32 IDENTITY_MAT[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+        // local position xyz, rotation xyzw and scale xyz, one float array each
+        constexpr u32_t POSE_POSITION = 0;
+        constexpr u32_t POSE_ROTATION = 3;
+        constexpr u32_t POSE_SCALE = 7;
+        constexpr u32_t POSE_FLOATS = 10;
+
+        // the pose of every transform on one depth, slot i of each array belongs to entities[i]. the kernels read
+        // the pose arrays in place, they are padded to whole batches so a batch may run past the last slot
+        struct level_t
+        {
+            std::vector<ecs::entity_t> entities;
+            std::vector<u32_t> parent_slots; // slot of the parent one level up, unused on level 0
+            std::vector<f32> pose[POSE_FLOATS];
+        };
+
+        // per world, lives in the registry ctx so worlds can be updated from different threads
+        struct hierarchy_t
+        {
+            // one level per hierarchy depth, a level only depends on the one before it.
+            // order inside a level does not matter so removal is a swap with the back
+            std::vector<level_t> levels;
+            // world matrices by depth and slot like the levels, kept apart from the pose the kernels read
+            std::vector<std::vector<mat4_t>> world;
+            std::vector<ecs::entity_t> subtree_stack;
+
+            // transforms touched since the last update, may hold duplicates and dead entities.
+            // update() expands them into their subtrees, bucketed by depth like the full hierarchy
+            std::vector<ecs::entity_t> dirty_list;
+            std::vector<std::vector<ecs::entity_t>> dirty_levels;
+            bool is_full_update_pending = false;
+        };
+
+        hierarchy_t& get_hierarchy(ecs::registry_t& reg)
+        {
+            if (hierarchy_t* hierarchy = reg.ctx().find<hierarchy_t>()) { return *hierarchy; }
+            return reg.ctx().emplace<hierarchy_t>();
+        }
 
-    bool is_hierarchy_dirty = true;
+        u32_t padded_size(size_t count)
+        { return static_cast<u32_t>((count + detail::KERNEL_BATCH - 1) / detail::KERNEL_BATCH * detail::KERNEL_BATCH); }
+
+        // local_* only reach the kernels through here, on insert and on mark_dirty
+        void write_pose(level_t& level, u32_t slot, const transform_t& transform)
+        {
+            for (u32_t c = 0; c < 3; c++)
+            {
+                level.pose[POSE_POSITION + c][slot] = transform.local_position[c];
+                level.pose[POSE_SCALE + c][slot] = transform.local_scale[c];
+            }
+            for (u32_t c = 0; c < 4; c++) { level.pose[POSE_ROTATION + c][slot] = transform.local_rotation[c]; }
+        }
+
+        void write_pose(hierarchy_t& hierarchy, const transform_t& transform)
+        { write_pose(hierarchy.levels[transform.depth], transform.level_index, transform); }
+
+        // the parent has to be in its level already
+        void level_insert(ecs::registry_t& reg, hierarchy_t& hierarchy, transform_t& transform, ecs::entity_t entity,
+                          u32_t depth, const mat4_t& world)
+        {
+            if (hierarchy.levels.size() <= depth)
+            {
+                hierarchy.levels.resize(depth + 1);
+                hierarchy.world.resize(depth + 1);
+            }
+
+            level_t& level = hierarchy.levels[depth];
+            u32_t slot = static_cast<u32_t>(level.entities.size());
+
+            transform.depth = depth;
+            transform.level_index = slot;
+            level.entities.push_back(entity);
+            level.parent_slots.push_back(depth > 0 ? reg.get<transform_t>(transform.parent).level_index : 0);
+            hierarchy.world[depth].push_back(world);
+
+            u32_t padded = padded_size(slot + 1);
+            if (level.pose[0].size() < padded)
+            {
+                for (std::vector<f32>& pose : level.pose) { pose.resize(padded, 0.0f); }
+            }
+            write_pose(level, slot, transform);
+        }
+
+        void level_remove(ecs::registry_t& reg, hierarchy_t& hierarchy, transform_t& transform)
+        {
+            if (transform.level_index == INVALID_LEVEL_INDEX) { return; }
+
+            level_t& level = hierarchy.levels[transform.depth];
+            std::vector<mat4_t>& world = hierarchy.world[transform.depth];
+            u32_t slot = transform.level_index;
+            u32_t last = static_cast<u32_t>(level.entities.size() - 1);
+
+            // cleared first, the moved transform may be the parent of the one leaving and must not repoint it
+            transform.level_index = INVALID_LEVEL_INDEX;
+
+            if (slot != last)
+            {
+                ecs::entity_t moved = level.entities[last];
+                level.entities[slot] = moved;
+                level.parent_slots[slot] = level.parent_slots[last];
+                world[slot] = world[last];
+                for (std::vector<f32>& pose : level.pose) { pose[slot] = pose[last]; }
+
+                // whoever hangs off the moved transform now finds its parent in the freed slot
+                transform_t& moved_transform = reg.get<transform_t>(moved);
+                moved_transform.level_index = slot;
+
+                ecs::entity_t child = moved_transform.first_child;
+                while (child != ecs::NULL_ENTITY)
+                {
+                    transform_t& child_transform = reg.get<transform_t>(child);
+                    if (child_transform.level_index != INVALID_LEVEL_INDEX)
+                    { hierarchy.levels[child_transform.depth].parent_slots[child_transform.level_index] = slot; }
+                    child = child_transform.next_sibling;
+                }
+            }
+
+            level.entities.pop_back();
+            level.parent_slots.pop_back();
+            world.pop_back();
+
+            while (!hierarchy.levels.empty() && hierarchy.levels.back().entities.empty())
+            {
+                hierarchy.levels.pop_back();
+                hierarchy.world.pop_back();
+            }
+        }
+
+        // re-buckets a whole subtree under a new root depth, O(subtree)
+        void move_subtree(ecs::registry_t& reg, ecs::entity_t root, u32_t depth)
+        {
+            hierarchy_t& hierarchy = get_hierarchy(reg);
+
+            // a new parent on the same depth only changes the slot the root reads its parent from
+            transform_t& root_transform = reg.get<transform_t>(root);
+            if (root_transform.level_index != INVALID_LEVEL_INDEX && root_transform.depth == depth)
+            {
+                if (depth > 0)
+                {
+                    hierarchy.levels[depth].parent_slots[root_transform.level_index] =
+                        reg.get<transform_t>(root_transform.parent).level_index;
+                }
+                return;
+            }
+
+            std::vector<ecs::entity_t>& subtree_stack = hierarchy.subtree_stack;
+            subtree_stack.clear();
+            subtree_stack.push_back(root);
+
+            while (!subtree_stack.empty())
+            {
+                ecs::entity_t entity = subtree_stack.back();
+                subtree_stack.pop_back();
+
+                transform_t& transform = reg.get<transform_t>(entity);
+                u32_t entity_depth = transform.parent == ecs::NULL_ENTITY || entity == root
+                                         ? depth
+                                         : reg.get<transform_t>(transform.parent).depth + 1;
+
+                // transforms that were never inserted start out at identity like a fresh one
+                mat4_t world;
+                if (transform.level_index != INVALID_LEVEL_INDEX)
+                { world = hierarchy.world[transform.depth][transform.level_index]; }
+
+                level_remove(reg, hierarchy, transform);
+                level_insert(reg, hierarchy, transform, entity, entity_depth, world);
+
+                ecs::entity_t child = transform.first_child;
+                while (child != ecs::NULL_ENTITY)
+                {
+                    subtree_stack.push_back(child);
+                    child = reg.get<transform_t>(child).next_sibling;
+                }
+            }
+        }
+
+        void unlink_from_parent(ecs::registry_t& reg, ecs::entity_t child, transform_t& child_transform)
+        {
+            if (child_transform.parent == ecs::NULL_ENTITY) { return; }
+
+            transform_t& old_parent = reg.get<transform_t>(child_transform.parent);
+
+            if (old_parent.first_child == child) { old_parent.first_child = child_transform.next_sibling; }
+            if (child_transform.prev_sibling != ecs::NULL_ENTITY)
+            {
+                reg.get<transform_t>(child_transform.prev_sibling).next_sibling = child_transform.next_sibling;
+            }
+            if (child_transform.next_sibling != ecs::NULL_ENTITY)
+            {
+                reg.get<transform_t>(child_transform.next_sibling).prev_sibling = child_transform.prev_sibling;
+            }
+
+            child_transform.parent = ecs::NULL_ENTITY;
+            child_transform.next_sibling = ecs::NULL_ENTITY;
+            child_transform.prev_sibling = ecs::NULL_ENTITY;
+        }
+    } // namespace
 
     void set_local_position(ecs::registry_t& reg, ecs::entity_t entity, vec3_t new_pos)
     {
         transform_t& transform = reg.get<transform_t>(entity);
         glm_vec3_copy(new_pos, transform.local_position);
-        transform.is_dirty = true;
+        mark_dirty(reg, entity);
     }
 
     void set_local_rotation(ecs::registry_t& reg, ecs::entity_t entity, quat_t new_rot)
     {
         transform_t& transform = reg.get<transform_t>(entity);
         glm_quat_copy(new_rot, transform.local_rotation);
-        transform.is_dirty = true;
+        mark_dirty(reg, entity);
     }
 
     void set_local_scale(ecs::registry_t& reg, ecs::entity_t entity, vec3_t new_scale)
     {
         transform_t& transform = reg.get<transform_t>(entity);
         glm_vec3_copy(new_scale, transform.local_scale);
-        transform.is_dirty = true;
+        mark_dirty(reg, entity);
     }
 
     vec3_t get_world_position(ecs::registry_t& reg, ecs::entity_t entity)
     {
-        transform_t& t = reg.get<transform_t>(entity);
+        const mat4_t& world = get_world_matrix(reg, entity);
 
-        vec3_t pos;
-        glm_vec3_copy(t.world_mat[3], pos);
-        return pos;
+        return {world[3][0], world[3][1], world[3][2]};
     }
 
     vec3_t get_world_scale(ecs::registry_t& reg, ecs::entity_t entity)
     {
-        transform_t& t = reg.get<transform_t>(entity);
+        const mat4_t& world = get_world_matrix(reg, entity);
+
+        vec3 axis_x = {world[0][0], world[0][1], world[0][2]};
+        vec3 axis_y = {world[1][0], world[1][1], world[1][2]};
+        vec3 axis_z = {world[2][0], world[2][1], world[2][2]};
 
         vec3_t scale;
-        scale.x = glm_vec3_norm(t.world_mat[0]);
-        scale.y = glm_vec3_norm(t.world_mat[1]);
-        scale.z = glm_vec3_norm(t.world_mat[2]);
+        scale.x = glm_vec3_norm(axis_x);
+        scale.y = glm_vec3_norm(axis_y);
+        scale.z = glm_vec3_norm(axis_z);
 
         return scale;
     }
 
     quat_t get_world_rotation(ecs::registry_t& reg, ecs::entity_t entity)
     {
-        transform_t& t = reg.get<transform_t>(entity);
+        const mat4_t& world = get_world_matrix(reg, entity);
         quat_t rot;
 
         mat4 temp_mat;
-        glm_mat4_copy(t.world_mat, temp_mat);
+        glm_mat4_copy(world, temp_mat);
 
         glm_vec3_normalize(temp_mat[0]);
         glm_vec3_normalize(temp_mat[1]);
@@ -92,10 +296,8 @@ namespace smol::transform_system
             return;
         }
 
-        transform_t& parent_t = reg.get<transform_t>(t.parent);
-
         mat4 parent_inv;
-        glm_mat4_inv(parent_t.world_mat, parent_inv);
+        glm_mat4_inv(get_world_matrix(reg, t.parent), parent_inv);
 
         vec3_t new_local_pos;
         glm_mat4_mulv3(parent_inv, target_world_pos, 1.0f, new_local_pos);
@@ -107,109 +309,385 @@ namespace smol::transform_system
     {
         transform_t& child_transform = reg.get<transform_t>(child);
 
-        if (child_transform.parent != ecs::NULL_ENTITY)
-        {
-            transform_t& old_parent = reg.get<transform_t>(parent);
-
-            if (old_parent.first_child == child) { old_parent.first_child = child_transform.next_sibling; }
-            if (child_transform.prev_sibling != ecs::NULL_ENTITY)
-            {
-                reg.get<transform_t>(child_transform.prev_sibling).next_sibling = child_transform.next_sibling;
-            }
-            if (child_transform.next_sibling != ecs::NULL_ENTITY)
-            {
-                reg.get<transform_t>(child_transform.next_sibling).prev_sibling = child_transform.prev_sibling;
-            }
-        }
-
-        child_transform.parent = parent;
-        child_transform.next_sibling = ecs::NULL_ENTITY;
-        child_transform.prev_sibling = ecs::NULL_ENTITY;
+        unlink_from_parent(reg, child, child_transform);
 
+        u32_t depth = 0;
         if (parent != ecs::NULL_ENTITY)
         {
             transform_t& new_parent_transform = reg.get<transform_t>(parent);
 
+            child_transform.parent = parent;
             child_transform.next_sibling = new_parent_transform.first_child;
             if (new_parent_transform.first_child != ecs::NULL_ENTITY)
             {
                 reg.get<transform_t>(new_parent_transform.first_child).prev_sibling = child;
             }
             new_parent_transform.first_child = child;
+
+            depth = new_parent_transform.depth + 1;
         }
 
-        is_hierarchy_dirty = true;
-        child_transform.is_dirty = true;
+        move_subtree(reg, child, depth);
+        mark_dirty(reg, child);
     }
 
-    static void rebuild_hierarchy(ecs::registry_t& reg)
+    void on_transform_created(ecs::registry_t& reg, ecs::entity_t entity)
+    {
+        transform_t& transform = reg.get<transform_t>(entity);
+        ecs::entity_t parent = transform.parent;
+
+        // links copied in from elsewhere mean nothing here, the new transform starts out as a root
+        transform.parent = ecs::NULL_ENTITY;
+        transform.first_child = ecs::NULL_ENTITY;
+        transform.next_sibling = ecs::NULL_ENTITY;
+        transform.prev_sibling = ecs::NULL_ENTITY;
+        transform.level_index = INVALID_LEVEL_INDEX;
+        transform.is_world_dirty = false;
+
+        level_insert(reg, get_hierarchy(reg), transform, entity, 0, mat4_t());
+        mark_dirty(reg, entity);
+
+        if (parent != ecs::NULL_ENTITY && reg.all_of<transform_t>(parent)) { set_parent(reg, entity, parent); }
+    }
+
+    void on_transform_destroyed(ecs::registry_t& reg, ecs::entity_t entity)
+    {
+        transform_t& transform = reg.get<transform_t>(entity);
+
+        unlink_from_parent(reg, entity, transform);
+
+        // orphans become roots instead of hanging off a dead parent
+        ecs::entity_t child = transform.first_child;
+        while (child != ecs::NULL_ENTITY)
+        {
+            transform_t& child_transform = reg.get<transform_t>(child);
+            ecs::entity_t next = child_transform.next_sibling;
+
+            child_transform.parent = ecs::NULL_ENTITY;
+            child_transform.next_sibling = ecs::NULL_ENTITY;
+            child_transform.prev_sibling = ecs::NULL_ENTITY;
+            move_subtree(reg, child, 0);
+            mark_dirty(reg, child);
+
+            child = next;
+        }
+        transform.first_child = ecs::NULL_ENTITY;
+
+        level_remove(reg, get_hierarchy(reg), transform);
+    }
+
+    void rebuild_hierarchy(ecs::registry_t& reg)
     {
         auto view = reg.view<transform_t>();
-        if (view.empty()) { return; }
 
-        sort_stack.clear();
-        sort_res.clear();
+        hierarchy_t& hierarchy = get_hierarchy(reg);
+        hierarchy.levels.clear();
+        hierarchy.world.clear();
+        hierarchy.dirty_list.clear();
+        for (ecs::entity_t entity : view)
+        {
+            transform_t& transform = view.get<transform_t>(entity);
+            transform.level_index = INVALID_LEVEL_INDEX;
+            transform.is_dirty = true;
+        }
 
         for (ecs::entity_t entity : view)
         {
-            if (view.get<transform_t>(entity).parent == ecs::NULL_ENTITY) { sort_stack.push_back(entity); }
+            transform_t& transform = view.get<transform_t>(entity);
+            if (transform.parent == ecs::NULL_ENTITY) { move_subtree(reg, entity, 0); }
+        }
+
+        hierarchy.is_full_update_pending = true;
+    }
+
+    void mark_dirty(ecs::registry_t& reg, ecs::entity_t entity)
+    {
+        hierarchy_t& hierarchy = get_hierarchy(reg);
+        transform_t& transform = reg.get<transform_t>(entity);
+        transform.is_dirty = true;
+        write_pose(hierarchy, transform);
+        hierarchy.dirty_list.push_back(entity);
+    }
+
+    void mark_dirty(ecs::registry_t& reg, std::span<const ecs::entity_t> entities)
+    {
+        hierarchy_t& hierarchy = get_hierarchy(reg);
+        auto view = reg.view<transform_t>();
+
+        // every entity owns its slot, so the copies into the pose arrays can go wide
+        jobs::parallel_for(
+            0, static_cast<u32_t>(entities.size()),
+            [&hierarchy, &view, entities](u32_t start, u32_t end)
+            {
+                for (u32_t i = start; i < end; i++)
+                {
+                    transform_t& transform = view.get<transform_t>(entities[i]);
+                    transform.is_dirty = true;
+                    write_pose(hierarchy, transform);
+                }
+            },
+            LEVEL_GRAIN);
+
+        hierarchy.dirty_list.insert(hierarchy.dirty_list.end(), entities.begin(), entities.end());
+    }
+
+    static void collect_dirty(ecs::registry_t& reg, hierarchy_t& hierarchy)
+    {
+        std::vector<std::vector<ecs::entity_t>>& dirty_levels = hierarchy.dirty_levels;
+        std::vector<ecs::entity_t>& subtree_stack = hierarchy.subtree_stack;
+
+        for (std::vector<ecs::entity_t>& level : dirty_levels) { level.clear(); }
+
+        for (ecs::entity_t root : hierarchy.dirty_list)
+        {
+            if (!reg.valid(root)) { continue; }
+
+            transform_t* root_transform = reg.try_get<transform_t>(root);
+            if (!root_transform || root_transform->is_world_dirty) { continue; }
+
+            subtree_stack.clear();
+            subtree_stack.push_back(root);
+
+            while (!subtree_stack.empty())
+            {
+                ecs::entity_t entity = subtree_stack.back();
+                subtree_stack.pop_back();
+
+                // already collected, and so was everything below it
+                transform_t& transform = reg.get<transform_t>(entity);
+                if (transform.is_world_dirty) { continue; }
+
+                transform.is_world_dirty = true;
+                if (dirty_levels.size() <= transform.depth) { dirty_levels.resize(transform.depth + 1); }
+                dirty_levels[transform.depth].push_back(entity);
+
+                ecs::entity_t child = transform.first_child;
+                while (child != ecs::NULL_ENTITY)
+                {
+                    subtree_stack.push_back(child);
+                    child = reg.get<transform_t>(child).next_sibling;
+                }
+            }
         }
 
-        // iterative dfs flatten
-        while (!sort_stack.empty())
+        hierarchy.dirty_list.clear();
+    }
+
+    // roots multiply by identity so every lane runs the same code
+    static const detail::mat4_batch_t& identity_batch()
+    {
+        alignas(32) static f32 lanes[16][detail::KERNEL_BATCH];
+        static const detail::mat4_batch_t batch = []()
         {
-            ecs::entity_t entity = sort_stack.back();
-            sort_stack.pop_back();
+            detail::mat4_batch_t result;
+            for (u32_t c = 0; c < 16; c++)
+            {
+                std::fill_n(lanes[c], detail::KERNEL_BATCH, IDENTITY_MAT[c]);
+                result.m[c] = lanes[c];
+            }
+            return result;
+        }();
+        return batch;
+    }
 
-            sort_res.push_back(entity);
+    // the kernel runs whole lanes, keep the tail of a partial batch from feeding it garbage
+    static void clear_tail(f32* soa, u32_t arrays, u32_t count)
+    {
+        constexpr u32_t N = detail::KERNEL_BATCH;
+        if (count == N) { return; }
+
+        for (u32_t a = 0; a < arrays; a++) { std::memset(soa + N * a + count, 0, sizeof(f32) * (N - count)); }
+    }
+
+    // slots [first, first + count) of one level, first a multiple of KERNEL_BATCH. the kernel reads the pose arrays
+    // in place, only the parent matrices and the result pass through the scratch arena
+    static void compose_slots(hierarchy_t& hierarchy, u32_t depth, u32_t first, u32_t count,
+                              detail::compose_kernel_t kernel)
+    {
+        constexpr u32_t N = detail::KERNEL_BATCH;
+
+        level_t& level = hierarchy.levels[depth];
+        std::vector<mat4_t>& world_mats = hierarchy.world[depth];
+
+        linear_allocator_t& arena = jobs::scratch();
+        size_t marker = arena.get_marker();
 
-            ecs::entity_t child = view.get<transform_t>(entity).first_child;
-            while (child != ecs::NULL_ENTITY)
+        f32* soa = static_cast<f32*>(arena.allocate(sizeof(f32) * N * 32, 32));
+
+        detail::trs_batch_t trs;
+        detail::mat4_batch_t parent, world;
+        for (u32_t c = 0; c < 3; c++) { trs.position[c] = level.pose[POSE_POSITION + c].data() + first; }
+        for (u32_t c = 0; c < 4; c++) { trs.rotation[c] = level.pose[POSE_ROTATION + c].data() + first; }
+        for (u32_t c = 0; c < 3; c++) { trs.scale[c] = level.pose[POSE_SCALE + c].data() + first; }
+        for (u32_t c = 0; c < 16; c++) { world.m[c] = soa + N * c; }
+
+        const detail::mat4_batch_t* parents = &identity_batch();
+        if (depth > 0)
+        {
+            clear_tail(soa + N * 16, 16, count);
+            for (u32_t c = 0; c < 16; c++) { parent.m[c] = soa + N * (16 + c); }
+
+            const std::vector<mat4_t>& parent_mats = hierarchy.world[depth - 1];
+            for (u32_t i = 0; i < count; i++)
             {
-                sort_stack.push_back(child);
-                child = view.get<transform_t>(child).next_sibling;
+                const f32* parent_mat = parent_mats[level.parent_slots[first + i]];
+                for (u32_t c = 0; c < 16; c++) { parent.m[c][i] = parent_mat[c]; }
             }
+            parents = &parent;
+        }
+
+        kernel(trs, *parents, world, count);
+
+        for (u32_t i = 0; i < count; i++)
+        {
+            f32* world_mat = world_mats[first + i];
+            for (u32_t c = 0; c < 16; c++) { world_mat[c] = world.m[c][i]; }
+        }
+
+        arena.rewind(marker);
+    }
+
+    // same for a scattered few transforms of one level, their poses are picked out of the level's arrays first
+    template <typename View>
+    static void compose_entities(View& view, hierarchy_t& hierarchy, u32_t depth, const ecs::entity_t* entities,
+                                 u32_t count, detail::compose_kernel_t kernel)
+    {
+        constexpr u32_t N = detail::KERNEL_BATCH;
+        constexpr u32_t FLOATS_PER_TRANSFORM = POSE_FLOATS + 16 * 2;
+
+        level_t& level = hierarchy.levels[depth];
+        std::vector<mat4_t>& world_mats = hierarchy.world[depth];
+
+        linear_allocator_t& arena = jobs::scratch();
+        size_t marker = arena.get_marker();
+
+        f32* soa = static_cast<f32*>(arena.allocate(sizeof(f32) * N * FLOATS_PER_TRANSFORM, 32));
+        clear_tail(soa, FLOATS_PER_TRANSFORM, count);
+
+        detail::trs_batch_t trs;
+        detail::mat4_batch_t parent, world;
+        for (u32_t c = 0; c < 3; c++) { trs.position[c] = soa + N * (POSE_POSITION + c); }
+        for (u32_t c = 0; c < 4; c++) { trs.rotation[c] = soa + N * (POSE_ROTATION + c); }
+        for (u32_t c = 0; c < 3; c++) { trs.scale[c] = soa + N * (POSE_SCALE + c); }
+        for (u32_t c = 0; c < 16; c++)
+        {
+            parent.m[c] = soa + N * (POSE_FLOATS + c);
+            world.m[c] = soa + N * (POSE_FLOATS + 16 + c);
+        }
+
+        u32_t slots[N];
+        for (u32_t i = 0; i < count; i++)
+        {
+            u32_t slot = view.template get<transform_t>(entities[i]).level_index;
+            slots[i] = slot;
+
+            for (u32_t a = 0; a < POSE_FLOATS; a++) { soa[N * a + i] = level.pose[a][slot]; }
+
+            const f32* parent_mat = depth > 0 ? hierarchy.world[depth - 1][level.parent_slots[slot]] : IDENTITY_MAT;
+            for (u32_t c = 0; c < 16; c++) { parent.m[c][i] = parent_mat[c]; }
         }
 
-        is_hierarchy_dirty = false;
+        kernel(trs, parent, world, count);
+
+        for (u32_t i = 0; i < count; i++)
+        {
+            f32* world_mat = world_mats[slots[i]];
+            for (u32_t c = 0; c < 16; c++) { world_mat[c] = world.m[c][i]; }
+        }
+
+        arena.rewind(marker);
     }
 
+    const mat4_t& get_world_matrix(ecs::registry_t& reg, ecs::entity_t entity)
+    { return get_world_matrix(reg, reg.get<transform_t>(entity)); }
+
+    const mat4_t& get_world_matrix(ecs::registry_t& reg, const transform_t& transform)
+    { return get_world_matrices(reg)[transform]; }
+
+    world_matrices_t get_world_matrices(ecs::registry_t& reg) { return world_matrices_t{&get_hierarchy(reg).world}; }
+
+    const std::vector<std::vector<ecs::entity_t>>& get_updated_levels(ecs::registry_t& reg)
+    { return get_hierarchy(reg).dirty_levels; }
+
     void update(ecs::registry_t& reg)
     {
         ZoneScoped;
+        static constexpr u32_t N = detail::KERNEL_BATCH;
+
+        // right after a full rebuild everything is dirty anyway, skip the walk and take the levels as they are
+        hierarchy_t& hierarchy = get_hierarchy(reg);
+        if (hierarchy.is_full_update_pending)
+        {
+            hierarchy.dirty_list.clear();
+            hierarchy.dirty_levels.resize(hierarchy.levels.size());
+            for (size_t depth = 0; depth < hierarchy.levels.size(); depth++)
+            { hierarchy.dirty_levels[depth] = hierarchy.levels[depth].entities; }
+        }
+        else
+        {
+            collect_dirty(reg, hierarchy);
+        }
+        hierarchy.is_full_update_pending = false;
 
-        if (is_hierarchy_dirty) { rebuild_hierarchy(reg); }
+        const std::vector<std::vector<ecs::entity_t>>& work = hierarchy.dirty_levels;
 
         auto view = reg.view<transform_t>();
+        detail::compose_kernel_t kernel = detail::get_compose_kernel();
 
-        for (ecs::entity_t entity : sort_res)
+        // parents are always one level up, so a level only has to wait for the previous one.
+        // a parent that is not in the work set did not move and its world matrix is current
+        for (u32_t depth = 0; depth < work.size(); depth++)
         {
-            transform_t& transform = view.get<transform_t>(entity);
+            const std::vector<ecs::entity_t>& dirty = work[depth];
+            if (dirty.empty()) { continue; }
 
-            bool is_local_dirty = transform.is_dirty;
-            if (is_local_dirty)
+            // once a good part of a level moved it is cheaper to stream through all of it than to pick out the dirty
+            // slots. the clean ones come out exactly as they were
+            u32_t level_size = static_cast<u32_t>(hierarchy.levels[depth].entities.size());
+            if (dirty.size() * 2 >= level_size)
             {
-                mat4_t t, r, s, trs;
-                glm_translate_make(t, transform.local_position);
-                glm_quat_mat4(transform.local_rotation, r);
-                glm_scale_make(s, transform.local_scale);
-                glm_mat4_mul(r, s, trs);
-                glm_mat4_mul(t, trs, transform.local_mat);
+                jobs::parallel_for(
+                    0, (level_size + N - 1) / N,
+                    [&hierarchy, depth, level_size, kernel](u32_t start, u32_t end)
+                    {
+                        for (u32_t batch = start; batch < end; batch++)
+                        {
+                            u32_t first = batch * N;
+                            compose_slots(hierarchy, depth, first, std::min(N, level_size - first), kernel);
+                        }
+                    },
+                    LEVEL_GRAIN / N);
             }
-
-            if (transform.parent != ecs::NULL_ENTITY)
+            else
             {
-                transform_t& parent_transform = view.get<transform_t>(transform.parent);
-
-                if (is_local_dirty || parent_transform.is_dirty)
-                {
-                    glm_mat4_mul(parent_transform.world_mat, (vec4*)transform.local_mat, transform.world_mat);
-                    transform.is_dirty = true;
-                }
+                jobs::parallel_for(
+                    0, static_cast<u32_t>(dirty.size()),
+                    [&view, &hierarchy, &dirty, depth, kernel](u32_t start, u32_t end)
+                    {
+                        for (u32_t batch = start; batch < end; batch += N)
+                        {
+                            compose_entities(view, hierarchy, depth, dirty.data() + batch, std::min(N, end - batch),
+                                             kernel);
+                        }
+                    },
+                    LEVEL_GRAIN);
             }
-            else if (is_local_dirty) { glm_mat4_copy(transform.local_mat, transform.world_mat); }
         }
 
-        for (ecs::entity_t entity : sort_res) { view.get<transform_t>(entity).is_dirty = false; }
+        for (const std::vector<ecs::entity_t>& level : work)
+        {
+            jobs::parallel_for(
+                0, static_cast<u32_t>(level.size()),
+                [&view, &level](u32_t start, u32_t end)
+                {
+                    for (u32_t i = start; i < end; i++)
+                    {
+                        transform_t& transform = view.get<transform_t>(level[i]);
+                        transform.is_dirty = false;
+                        transform.is_world_dirty = false;
+                    }
+                },
+                LEVEL_GRAIN);
+        }
     }
 } // namespace smol::transform_system
\ No newline at end of file
@@ -1,23 +1,57 @@
 #pragma once
 
+#include "smol/components/transform.h"
 #include "smol/ecs_fwd.h"
 #include "smol/math.h"
 
+#include <span>
+#include <vector>
+
 namespace smol::transform_system
 {
-    extern bool is_hierarchy_dirty;
-
     SMOL_ENGINE_API void set_local_position(ecs::registry_t& reg, ecs::entity_t entity, vec3_t new_pos);
     SMOL_ENGINE_API void set_local_rotation(ecs::registry_t& reg, ecs::entity_t entity, quat_t new_rot);
     SMOL_ENGINE_API void set_local_scale(ecs::registry_t& reg, ecs::entity_t entity, vec3_t new_scale);
 
+    // world matrices by depth and slot, for loops over many transforms that would otherwise look up the registry
+    // for each one
+    struct world_matrices_t
+    {
+        const std::vector<std::vector<mat4_t>>* levels = nullptr;
+
+        const mat4_t& operator[](const transform_t& transform) const
+        { return (*levels)[transform.depth][transform.level_index]; }
+    };
+
+    // world matrices live with the rest of the pose in the transform system. references stay valid until a transform
+    // is created, destroyed or reparented
+    SMOL_ENGINE_API const mat4_t& get_world_matrix(ecs::registry_t& reg, ecs::entity_t entity);
+    SMOL_ENGINE_API const mat4_t& get_world_matrix(ecs::registry_t& reg, const transform_t& transform);
+    SMOL_ENGINE_API world_matrices_t get_world_matrices(ecs::registry_t& reg);
+
     SMOL_ENGINE_API vec3_t get_world_position(ecs::registry_t& reg, ecs::entity_t entity);
     SMOL_ENGINE_API vec3_t get_world_scale(ecs::registry_t& reg, ecs::entity_t entity);
     SMOL_ENGINE_API quat_t get_world_rotation(ecs::registry_t& reg, ecs::entity_t entity);
 
     SMOL_ENGINE_API void set_world_position(ecs::registry_t& reg, ecs::entity_t entity, vec3_t world_pos);
 
+    // queues the transform and its subtree for the next update, call after writing local_* directly. this is where
+    // local_* are copied to the pose the kernels read
+    SMOL_ENGINE_API void mark_dirty(ecs::registry_t& reg, ecs::entity_t entity);
+    // same for many at once, for callers that collected them on several threads. entities must not repeat
+    SMOL_ENGINE_API void mark_dirty(ecs::registry_t& reg, std::span<const ecs::entity_t> entities);
+
     SMOL_ENGINE_API void set_parent(ecs::registry_t& reg, ecs::entity_t child, ecs::entity_t parent);
 
+    // hooked to transform_t construct/destroy, keep the depth buckets in sync one subtree at a time
+    void on_transform_created(ecs::registry_t& reg, ecs::entity_t entity);
+    void on_transform_destroyed(ecs::registry_t& reg, ecs::entity_t entity);
+
+    // full rebuild, only for registries that were filled before the hooks were connected
+    void rebuild_hierarchy(ecs::registry_t& reg);
+
     void update(ecs::registry_t& reg);
+
+    // transforms whose world matrix the last update() rewrote, bucketed by depth. valid until the next update
+    SMOL_ENGINE_API const std::vector<std::vector<ecs::entity_t>>& get_updated_levels(ecs::registry_t& reg);
 } // namespace smol::transform_system
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "transform_kernels.h"
+
+#include "smol/log.h"
+
+#include <SDL3/SDL_cpuinfo.h>
+#include <cfloat>
+#include <cstring>
+
+// vector extensions and target attributes are gcc/clang only (clang-cl included), msvc gets the scalar kernel
+#if defined(__GNUC__) || defined(__clang__)
+#define SMOL_TRANSFORM_VECTOR_KERNELS 1
+#define SMOL_KERNEL_INLINE [[gnu::always_inline]] inline
+#elif defined(_MSC_VER)
+#define SMOL_KERNEL_INLINE __forceinline
+#else
+#define SMOL_KERNEL_INLINE inline
+#endif
+
+#if SMOL_TRANSFORM_VECTOR_KERNELS && (defined(__x86_64__) || defined(_M_X64))
+#define SMOL_TRANSFORM_AVX2_KERNEL 1
+#endif
+
+namespace smol::transform_system::detail
+{
+    namespace
+    {
+#if SMOL_TRANSFORM_VECTOR_KERNELS
+        // compiler vector extensions, sse on x64 and neon on arm64 for 4 lanes
+        typedef f32 f32x4_t __attribute__((vector_size(16)));
+        typedef f32 f32x8_t __attribute__((vector_size(32)));
+#endif
+
+        // out param instead of a return value, avx vectors returned from a non avx function trip -Wpsabi
+        template <typename V>
+        SMOL_KERNEL_INLINE void load(V& v, const f32* src)
+        { std::memcpy(&v, src, sizeof(V)); }
+
+        template <typename V>
+        SMOL_KERNEL_INLINE void store(f32* dst, const V& v)
+        { std::memcpy(dst, &v, sizeof(V)); }
+
+        // lane for lane the same math as glm_quat_mat4 + glm_mat4_mul, V = f32 is the scalar version. the quaternion is
+        // scaled by 2 / |q|^2 which equals cglm for unit quaternions and stays a rotation otherwise
+        template <typename V>
+        SMOL_KERNEL_INLINE void compose_lanes(const trs_batch_t& trs, const mat4_batch_t& parent,
+                                              const mat4_batch_t& world, u32_t count)
+        {
+            constexpr u32_t LANES = sizeof(V) / sizeof(f32);
+
+            for (u32_t i = 0; i < count; i += LANES)
+            {
+                V px, py, pz, x, y, z, w, sx, sy, sz;
+                load(px, trs.position[0] + i);
+                load(py, trs.position[1] + i);
+                load(pz, trs.position[2] + i);
+
+                load(x, trs.rotation[0] + i);
+                load(y, trs.rotation[1] + i);
+                load(z, trs.rotation[2] + i);
+                load(w, trs.rotation[3] + i);
+
+                load(sx, trs.scale[0] + i);
+                load(sy, trs.scale[1] + i);
+                load(sz, trs.scale[2] + i);
+
+                V s = 2.0f / (x * x + y * y + z * z + w * w + FLT_MIN);
+
+                V xx = s * x * x, xy = s * x * y, wx = s * w * x;
+                V yy = s * y * y, yz = s * y * z, wy = s * w * y;
+                V zz = s * z * z, xz = s * x * z, wz = s * w * z;
+
+                // upper 3x3 of the local matrix, its last column is the position and the last row 0 0 0 1
+                V l[3][3] = {
+                    {(1.0f - yy - zz) * sx, (xy + wz) * sx, (xz - wy) * sx},
+                    {(xy - wz) * sy, (1.0f - xx - zz) * sy, (yz + wx) * sy},
+                    {(xz + wy) * sz, (yz - wx) * sz, (1.0f - xx - yy) * sz},
+                };
+
+                for (u32_t row = 0; row < 4; row++)
+                {
+                    V p0, p1, p2, p3;
+                    load(p0, parent.m[0 + row] + i);
+                    load(p1, parent.m[4 + row] + i);
+                    load(p2, parent.m[8 + row] + i);
+                    load(p3, parent.m[12 + row] + i);
+
+                    for (u32_t col = 0; col < 3; col++)
+                    { store(world.m[col * 4 + row] + i, p0 * l[col][0] + p1 * l[col][1] + p2 * l[col][2]); }
+                    store(world.m[12 + row] + i, p0 * px + p1 * py + p2 * pz + p3);
+                }
+            }
+        }
+
+#if SMOL_TRANSFORM_VECTOR_KERNELS
+        void compose_x4(const trs_batch_t& trs, const mat4_batch_t& parent, const mat4_batch_t& world, u32_t count)
+        { compose_lanes<f32x4_t>(trs, parent, world, count); }
+#else
+        void compose_x1(const trs_batch_t& trs, const mat4_batch_t& parent, const mat4_batch_t& world, u32_t count)
+        { compose_lanes<f32>(trs, parent, world, count); }
+#endif
+
+#if SMOL_TRANSFORM_AVX2_KERNEL
+        __attribute__((target("avx2,fma"))) void compose_x8(const trs_batch_t& trs, const mat4_batch_t& parent,
+                                                             const mat4_batch_t& world, u32_t count)
+        { compose_lanes<f32x8_t>(trs, parent, world, count); }
+#endif
+
+        compose_kernel_t select_compose_kernel()
+        {
+#if SMOL_TRANSFORM_AVX2_KERNEL
+            if (SDL_HasAVX2())
+            {
+                SMOL_LOG_INFO("TRANSFORM", "Using AVX2 transform kernels");
+                return &compose_x8;
+            }
+#endif
+#if SMOL_TRANSFORM_VECTOR_KERNELS
+            SMOL_LOG_INFO("TRANSFORM", "Using 4 wide transform kernels");
+            return &compose_x4;
+#else
+            SMOL_LOG_INFO("TRANSFORM", "Using scalar transform kernels");
+            return &compose_x1;
+#endif
+        }
+    } // namespace
+
+    compose_kernel_t get_compose_kernel()
+    {
+        static compose_kernel_t kernel = select_compose_kernel();
+        return kernel;
+    }
+} // namespace smol::transform_system::detail
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "smol/defines.h"
+
+namespace smol::transform_system::detail
+{
+    // transforms handled per kernel call, a multiple of every kernel's lane width
+    constexpr u32_t KERNEL_BATCH = 64;
+
+    // structure of arrays view of a batch, every array holds KERNEL_BATCH floats
+    struct trs_batch_t
+    {
+        f32* position[3];
+        f32* rotation[4];
+        f32* scale[3];
+    };
+
+    // column major like mat4_t, m[col * 4 + row]
+    struct mat4_batch_t
+    {
+        f32* m[16];
+    };
+
+    // world = parent * T * R * S. count is rounded up to the lane width so the padding lanes
+    // have to hold harmless values
+    using compose_kernel_t = void (*)(const trs_batch_t& trs, const mat4_batch_t& parent, const mat4_batch_t& world,
+                                      u32_t count);
+
+    // picks the widest kernel the cpu supports, resolved once on first use
+    compose_kernel_t get_compose_kernel();
+} // namespace smol::transform_system::detail
\ No newline at end of file
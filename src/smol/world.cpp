@@ -1,23 +1,41 @@
 #include "world.h"
 
+#include "smol/components/physics.h"
+#include "smol/components/renderer.h"
 #include "smol/components/transform.h"
 #include "smol/ecs_fwd.h"
+#include "smol/events.h"
 #include "smol/physics/physics_sync.h"
 #include "smol/physics/physics_world.h"
 #include "smol/profiling.h"
+#include "smol/systems/spatial.h"
 #include "smol/systems/transform.h"
 
 namespace smol
 {
-    void on_transform_changed(ecs::registry_t& reg, ecs::entity_t entity)
-    { smol::transform_system::is_hierarchy_dirty = true; }
-
     void world_t::init()
     {
         registry.ctx().emplace<physics_world_t*>(&physics);
+        events::get_queues(registry);
+
+        registry.on_construct<transform_t>().connect<&transform_system::on_transform_created>();
+        registry.on_destroy<transform_t>().connect<&transform_system::on_transform_destroyed>();
+        transform_system::rebuild_hierarchy(registry);
 
-        registry.on_construct<transform_t>().connect<&on_transform_changed>();
-        registry.on_destroy<transform_t>().connect<&on_transform_changed>();
+        registry.on_construct<transform_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_destroy<transform_t>().connect<&spatial_system::on_source_destroyed>();
+        registry.on_construct<mesh_renderer_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_update<mesh_renderer_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_destroy<mesh_renderer_t>().connect<&spatial_system::on_source_destroyed>();
+        registry.on_construct<rigidbody_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_destroy<rigidbody_t>().connect<&spatial_system::on_source_destroyed>();
+        registry.on_construct<box_collider_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_update<box_collider_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_destroy<box_collider_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_construct<sphere_collider_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_update<sphere_collider_t>().connect<&spatial_system::on_source_changed>();
+        registry.on_destroy<sphere_collider_t>().connect<&spatial_system::on_source_changed>();
+        spatial_system::rebuild(registry);
 
         physics.init(registry);
 
@@ -27,15 +45,16 @@ namespace smol
     void world_t::update()
     {
         ZoneScoped;
-        for (system_func_t& system : update_systems) { system(registry); }
+        update_schedule.run(registry);
     }
 
     void world_t::fixed_update()
     {
         ZoneScoped;
+        physics::restore_poses(registry, physics);
         physics.create_bodies(registry);
 
-        for (system_func_t& system : fixed_update_systems) { system(registry); }
+        fixed_update_schedule.run(registry);
 
         physics::sync_to_physics(registry, physics);
         physics.update();
@@ -54,7 +73,5 @@ namespace smol
     }
 
     void world_t::register_init_system(system_func_t system) { init_systems.push_back(system); }
-    void world_t::register_update_system(system_func_t system) { update_systems.push_back(system); }
-    void world_t::register_fixed_update_system(system_func_t system) { fixed_update_systems.push_back(system); }
     void world_t::register_shutdown_system(system_func_t system) { shutdown_systems.push_back(system); }
 } // namespace smol
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "smol/ecs.h"
 #include "smol/physics/physics_world.h"
+#include "smol/system_schedule.h"
 
 #include <vector>
 
@@ -11,8 +12,6 @@ namespace smol
 {
     namespace reflection { using ctx_t = entt::meta_ctx; }
 
-    using system_func_t = void (*)(ecs::registry_t&);
-
     struct SMOL_ENGINE_API world_t
     {
         std::string name;
@@ -21,8 +20,8 @@ namespace smol
         physics_world_t physics;
 
         std::vector<system_func_t> init_systems;
-        std::vector<system_func_t> update_systems;
-        std::vector<system_func_t> fixed_update_systems;
+        system_schedule_t update_schedule;
+        system_schedule_t fixed_update_schedule;
         std::vector<system_func_t> shutdown_systems;
 
         void init();
@@ -31,8 +30,22 @@ namespace smol
         void shutdown();
 
         void register_init_system(system_func_t system);
-        void register_update_system(system_func_t system);
-        void register_fixed_update_system(system_func_t system);
         void register_shutdown_system(system_func_t system);
+
+        // Access is a list of reads<...>/writes<...>, systems that don't conflict run in parallel on the job system.
+        // without any access the system is exclusive and runs alone on the thread stepping the world, see
+        // system_access_t
+        template <typename... Access>
+        system_id_t register_update_system(system_func_t system)
+        { return update_schedule.add(system, make_system_access<Access...>()); }
+
+        template <typename... Access>
+        system_id_t register_fixed_update_system(system_func_t system)
+        { return fixed_update_schedule.add(system, make_system_access<Access...>()); }
+
+        // forces first to finish before then starts, also flips the default order of conflicting systems
+        void order_update_systems(system_id_t first, system_id_t then) { update_schedule.add_ordering(first, then); }
+        void order_fixed_update_systems(system_id_t first, system_id_t then)
+        { fixed_update_schedule.add_ordering(first, then); }
     };
 } // namespace smol
\ No newline at end of file
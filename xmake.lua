@@ -23,6 +23,19 @@ option("profiling")
     add_defines("TRACY_ENABLE")
 option_end()
 
+option("job_stats")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Collect job system counters (jobs::get_stats)")
+    add_defines("SMOL_ENABLE_JOB_STATS")
+option_end()
+
+option("benchmarks")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Build the smol-bench micro benchmarks")
+option_end()
+
 option("standalone")
     set_default(false)
     set_showmenu(true)
@@ -88,6 +101,7 @@ target("smol-engine")
     add_rules("smol.common")
 
     add_options("profiling", {public = true})
+    add_options("job_stats", {public = true})
 
     add_defines("SMOL_ENGINE_EXPORT", "CGLM_FORCE_LEFT_HANDED")
 
@@ -310,6 +324,18 @@ target("smol-assets")
 target_end()
 end
 
+if has_config("benchmarks") and not standalone then
+target("smol-bench")
+    set_kind("binary")
+
+    add_rules("smol.common")
+
+    add_deps("smol-engine")
+
+    add_files("src/smol-bench/**.cpp")
+target_end()
+end
+
 if not standalone then
 target("smol-editor")
     set_kind("binary")